@@ -0,0 +1,111 @@
+#include "ev.h"
+
+//#define USE_BACKEND_EPOLL
+
+#ifdef USE_BACKEND_EPOLL
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // epoll_pwait2
+#endif
+#include <sys/epoll.h>
+#include <errno.h>
+#include <time.h>
+#include "port.h"
+
+// epoll_pwait2(纳秒级超时)自glibc 2.35提供,否则超时向上取整到毫秒.
+#if defined(__GLIBC__) && ((__GLIBC__>2) || (__GLIBC__==2 && __GLIBC_MINOR__>=35))
+#define BACKEND_EPOLL_PWAIT2
+#endif
+
+
+static void backend_epoll_modify(
+	struct ev_loop_t *ev_loop, fd_type_t fd, 
+	int32_t old_events, int32_t new_events
+)
+{
+	if(old_events==new_events)
+		return;
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.data.fd = fd;
+	if(new_events & EV_READABLE)
+		ev.events |= EPOLLIN;
+	if(new_events & EV_WRITABLE)
+		ev.events |= EPOLLOUT;
+	if(new_events & EV_EDGE)
+		ev.events |= EPOLLET;
+
+	int op = EPOLL_CTL_MOD;
+	if(!(new_events & EV_RW))
+		op = EPOLL_CTL_DEL;
+	else if(!(old_events & EV_RW))
+		op = EPOLL_CTL_ADD;
+
+	// fd关闭后重新打开时,内核与anfds中的注册状态可能不一致.
+	int ret = epoll_ctl(ev_loop->backend_fd, op, fd, &ev);
+	if(ret && op==EPOLL_CTL_ADD && errno==EEXIST)
+		ret = epoll_ctl(ev_loop->backend_fd, (op=EPOLL_CTL_MOD), fd, &ev);
+	else if(ret && op==EPOLL_CTL_MOD && errno==ENOENT)
+		ret = epoll_ctl(ev_loop->backend_fd, (op=EPOLL_CTL_ADD), fd, &ev);
+	if(ret)
+	{
+		// fd已关闭时内核自动将其移出epoll
+		if(op==EPOLL_CTL_DEL && (errno==EBADF || errno==ENOENT))
+			return;
+		FATAL_ERROR("epoll_ctl op %d on fd %d failed, errno %d\n", op, fd, errno);
+	}
+}
+
+static void backend_epoll_poll(struct ev_loop_t *ev_loop, struct ev_duration_t *timeout)
+{
+	struct epoll_event backend_epoll_events[MAX_FD_NUMS];
+	int ret;
+#ifdef BACKEND_EPOLL_PWAIT2
+	struct timespec ts, *ts_ptr = NULL;
+	if(timeout)
+	{
+		ts.tv_sec = timeout->seconds;
+		ts.tv_nsec = (long)(timeout->micro_seconds)*1000;
+		ts_ptr = &ts;
+	}
+	ret = epoll_pwait2(ev_loop->backend_fd, backend_epoll_events, MAX_FD_NUMS, ts_ptr, NULL);
+	if(ret<0 && errno==ENOSYS)
+#endif
+	{
+		int timeout_ms = -1;
+		if(timeout)
+			timeout_ms = timeout->seconds*1000 + (timeout->micro_seconds+999)/1000;
+		ret = epoll_wait(ev_loop->backend_fd, backend_epoll_events, MAX_FD_NUMS, timeout_ms);
+	}
+	if(ret<0)
+	{
+		if(errno==EINTR)
+			return;
+		FATAL_ERROR("epoll_wait failed, errno %d\n", errno);
+	}
+
+	int i;
+	for(i=0; i<ret; ++i)
+	{
+		struct epoll_event *ev = &backend_epoll_events[i];
+		int32_t events = EV_NONE;
+		// 错误/挂断时按可读写报告,由回调中的读写得到具体错误.
+		if(ev->events & (EPOLLIN|EPOLLERR|EPOLLHUP))
+			events |= EV_READABLE;
+		if(ev->events & (EPOLLOUT|EPOLLERR|EPOLLHUP))
+			events |= EV_WRITABLE;
+		ev_io_event(ev_loop, ev->data.fd, events);
+	}
+}
+
+void install_backend_impl(ev_loop_t *ev_loop)
+{
+	ev_loop->backend_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(ev_loop->backend_fd<0)
+		FATAL_ERROR("epoll_create1 failed, errno %d\n", errno);
+	ev_loop->backend_max_fd = 0x7FFFFFFF;
+	ev_loop->backend_modify = backend_epoll_modify;
+	ev_loop->backend_poll = backend_epoll_poll;
+}
+#endif
+
@@ -1,26 +1,83 @@
 #include "ev.h"
 
+#ifndef USE_BACKEND_EPOLL
 #define USE_BACKEND_SELECT
 //#undef USE_BACKEND_SELECT
+#endif
 
 #ifdef USE_BACKEND_SELECT
+#include <sys/select.h>
+#include <errno.h>
+#include "port.h"
+
+/*
+ * select关注的描述符集合在每次poll时由anfds生成,backend自身不保存状态.
+ *
+ * select只支持水平触发,EV_EDGE被忽略:边沿触发的ev_io未读/写尽时,
+ * select会重复报告该fd,而ev_io已在pendings或anreadys中,不会重复就绪.
+ */
 static void backend_select_modify(
 	struct ev_loop_t *ev_loop, fd_type_t fd, 
 	int32_t old_events, int32_t new_events
 )
 {
-	if(old_events==new_events)
-		return;
-
-	
+	// fd_set只能容纳[0, FD_SETSIZE)的fd,外部来源的fd应先与backend_max_fd比较.
+	if((new_events & EV_RW) && (fd<0 || fd>=FD_SETSIZE))
+		FATAL_ERROR("fd %d exceeds FD_SETSIZE which is %d, use the epoll backend.\n", fd, FD_SETSIZE);
 }
 
 static void backend_select_poll(struct ev_loop_t *ev_loop, struct ev_duration_t *timeout)
 {
+	fd_set rfds, wfds;
+	FD_ZERO(&rfds);
+	FD_ZERO(&wfds);
+	int32_t i, max_fd = -1;
+	for(i=0; i<ev_loop->anfd_cnt; ++i)
+	{
+		ANFD *anfd = &(ev_loop->anfds[i]);
+		if(anfd->events_focused & EV_READABLE)
+			FD_SET(anfd->fd, &rfds);
+		if(anfd->events_focused & EV_WRITABLE)
+			FD_SET(anfd->fd, &wfds);
+		if((anfd->events_focused & EV_RW) && anfd->fd>max_fd)
+			max_fd = anfd->fd;
+	}
+
+	struct timeval tv, *tv_ptr = NULL;
+	if(timeout)
+	{
+		tv.tv_sec = timeout->seconds;
+		tv.tv_usec = timeout->micro_seconds;
+		tv_ptr = &tv;
+	}
+
+	int ret = select(max_fd+1, &rfds, &wfds, NULL, tv_ptr);
+	if(ret<0)
+	{
+		if(errno==EINTR)
+			return;
+		FATAL_ERROR("select failed, errno %d\n", errno);
+	}
+
+	for(i=0; ret>0 && i<ev_loop->anfd_cnt; ++i)
+	{
+		fd_type_t fd = ev_loop->anfds[i].fd;
+		int32_t events = EV_NONE;
+		if(FD_ISSET(fd, &rfds))
+			events |= EV_READABLE;
+		if(FD_ISSET(fd, &wfds))
+			events |= EV_WRITABLE;
+		if(events)
+		{
+			ev_io_event(ev_loop, fd, events);
+			--ret;
+		}
+	}
 }
 
 void install_backend_impl(ev_loop_t *ev_loop)
 {
+	ev_loop->backend_max_fd = FD_SETSIZE-1;
 	ev_loop->backend_modify = backend_select_modify;
 	ev_loop->backend_poll = backend_select_poll;
 }
@@ -0,0 +1,88 @@
+#include "coro.h"
+
+static void ev_coro_resume(ev_coro_t *coro, int32_t events)
+{
+	coro->events = events;
+	coro->waiting = EV_NONE;
+	coro->run(coro);
+}
+
+static void on_coro_io(ev_loop_t *ev_loop, ev_io_t *ev_io, int events)
+{
+	ev_coro_t *coro = (ev_coro_t*)(ev_io->data);
+	int32_t event_occur = events & coro->waiting;
+	if(!event_occur)
+		return;
+	ev_timer_stop(ev_loop, &coro->timer);
+	ev_coro_resume(coro, event_occur);
+}
+
+static void on_coro_timeout(ev_loop_t *ev_loop, ev_timer_t *timer, int events)
+{
+	ev_coro_t *coro = (ev_coro_t*)(timer->data);
+	if(!(coro->waiting & EV_TIMEOUT))
+		return;
+	ev_coro_resume(coro, EV_TIMEOUT);
+}
+
+void ev_coro_init(ev_coro_t *coro, void (*run)(ev_coro_t *coro), void *data)
+{
+	coro->line = 0;
+	coro->ev_loop = NULL;
+	ev_io_init(&coro->io, on_coro_io, -1, EV_NONE);
+	coro->io.data = coro;
+	ev_timer_init(&coro->timer, on_coro_timeout);
+	coro->timer.data = coro;
+	coro->waiting = EV_NONE;
+	coro->events = EV_NONE;
+	coro->done = 0;
+	coro->run = run;
+	coro->data = data;
+}
+
+void ev_coro_start(struct ev_loop_t *ev_loop, ev_coro_t *coro)
+{
+	ev_coro_stop(coro);
+	coro->ev_loop = ev_loop;
+	coro->line = 0;
+	coro->done = 0;
+	ev_coro_resume(coro, EV_NONE);
+}
+
+void ev_coro_stop(ev_coro_t *coro)
+{
+	if(!coro->ev_loop)
+		return;
+	ev_io_stop(coro->ev_loop, &coro->io);
+	ev_timer_stop(coro->ev_loop, &coro->timer);
+	coro->waiting = EV_NONE;
+}
+
+void ev_coro_arm(ev_coro_t *coro, fd_type_t fd, int32_t events, ev_duration_t *timeout)
+{
+	ev_loop_t *ev_loop = coro->ev_loop;
+	events &= EV_RW;
+
+	// io : 同一fd上仅修改关注的事件,更换fd时才重新start.
+	if(events)
+	{
+		if(ev_is_active(&coro->io) && coro->io.fd!=fd)
+			ev_io_stop(ev_loop, &coro->io);
+		if(ev_is_inactive(&coro->io)){
+			ev_io_set(&coro->io, fd, events);
+			ev_io_start(ev_loop, &coro->io);
+		}else{
+			ev_io_modify(ev_loop, &coro->io, events);
+		}
+	}else if(ev_is_active(&coro->io)){
+		ev_io_modify(ev_loop, &coro->io, EV_NONE);
+	}
+
+	// timer : 定时器链表按间隔排序,重新设置间隔需stop/start.
+	ev_timer_stop(ev_loop, &coro->timer);
+	if(timeout)
+		ev_timer_start(ev_loop, &coro->timer, timeout);
+
+	coro->waiting = events|(timeout?EV_TIMEOUT:EV_NONE);
+}
+
@@ -0,0 +1,90 @@
+
+#ifndef _CORO_H_
+#define _CORO_H_
+
+#include "ev.h"
+
+/*
+ * ev_coro : 基于事件循环的无栈协程(protothread方式),无内存分配.
+ *
+ * 协程体为一个函数,以EV_CORO_BEGIN/EV_CORO_END包围,在EV_CORO_AWAIT_*处让出,
+ * 由内嵌的io/定时事件在条件满足时重新进入并从让出处继续.
+ * 协程体中的局部变量在让出后不保留,需跨越让出的状态应保存在data中.
+ * 协程体内不可使用switch语句包含EV_CORO_AWAIT_*.
+ *
+ * line : 恢复点;
+ * io/timer : 各次等待复用的io/定时事件,等待同一fd时不重复start/stop;
+ * waiting : 当前等待的事件;
+ * events : 最近一次恢复的原因(EV_READABLE/EV_WRITABLE/EV_TIMEOUT);
+ * done : 协程体是否已结束;
+ * run : 协程体;
+ * data : 自定义数据.
+ */
+typedef struct ev_coro_t{
+	int32_t line;
+	struct ev_loop_t *ev_loop;
+	ev_io_t io;
+	ev_timer_t timer;
+	int32_t waiting;
+	int32_t events;
+	int32_t done;
+	void (*run)(struct ev_coro_t *coro);
+	void *data;
+}ev_coro_t;
+
+void ev_coro_init(ev_coro_t *coro, void (*run)(ev_coro_t *coro), void *data);
+
+// 从头开始运行协程体,直到第一次让出.
+void ev_coro_start(struct ev_loop_t *ev_loop, ev_coro_t *coro);
+// 停止等待,之后不再恢复.
+void ev_coro_stop(ev_coro_t *coro);
+
+/*
+ * 设置下次让出时等待的事件:fd上的events(EV_NONE为不等待io),
+ * 及超时timeout(NULL为不等待超时).
+ */
+void ev_coro_arm(ev_coro_t *coro, fd_type_t fd, int32_t events, ev_duration_t *timeout);
+
+#define EV_CORO_BEGIN(coro) \
+	switch((coro)->line){ \
+	case 0: \
+
+#define EV_CORO_END(coro) \
+	} \
+	ev_coro_stop(coro); \
+	(coro)->done = 1; \
+	return; \
+
+#define EV_CORO_AWAIT_(coro) do{ \
+	(coro)->line = __LINE__; \
+	return; \
+	case __LINE__:; \
+}while(0) \
+
+// 等待fd可读.
+#define EV_CORO_AWAIT_READABLE(coro, fd) do{ \
+	ev_coro_arm((coro), (fd), EV_READABLE, NULL); \
+	EV_CORO_AWAIT_(coro); \
+}while(0) \
+
+// 等待timeout.
+#define EV_CORO_AWAIT_TIMEOUT(coro, timeout) do{ \
+	ev_coro_arm((coro), -1, EV_NONE, (timeout)); \
+	EV_CORO_AWAIT_(coro); \
+}while(0) \
+
+// 等待fd上的events或timeout,以(coro)->events区分恢复的原因.
+#define EV_CORO_AWAIT_ANY(coro, fd, events, timeout) do{ \
+	ev_coro_arm((coro), (fd), (events), (timeout)); \
+	EV_CORO_AWAIT_(coro); \
+}while(0) \
+
+// 协程体中提前结束.
+#define EV_CORO_EXIT(coro) do{ \
+	ev_coro_stop(coro); \
+	(coro)->done = 1; \
+	return; \
+}while(0) \
+
+#endif
+
@@ -40,6 +40,70 @@
 	((anpending->event_occur<events)?(-1): \
 		(anpending->event_occur>events)?(1):(0))
 
+/*************
+ * ev_trace
+ *************/
+#ifdef EV_TRACE
+static void ev_trace_record(ev_loop_t *ev_loop, int32_t type, ev_base_t *ev, int32_t arg0, int32_t arg1)
+{
+	ev_trace_ring_t *ring = &(ev_loop->trace);
+	int64_t head = ring->head;
+	ev_trace_record_t *record = &(ring->records[head&(EV_TRACE_RECORD_NUM-1)]);
+	record->stamp = get_trace_stamp();
+	record->type = type;
+	record->arg0 = arg0;
+	record->arg1 = arg1;
+	if(ev)
+		memcpy(record->name, ev->name, sizeof(record->name));
+	else
+		record->name[0] = '\0';
+	__atomic_store_n(&ring->head, head+1, __ATOMIC_RELEASE);
+}
+
+// 阻塞时长换算为us,超出int32范围的截断为最大值,NULL(不限)为-1.
+static int32_t ev_trace_block_us(ev_duration_t *block)
+{
+	if(!block)
+		return -1;
+	int64_t us = (int64_t)block->seconds*MICRO_SECONDS_ONE_SECOND+block->micro_seconds;
+	return (us>0x7FFFFFFF)?0x7FFFFFFF:(int32_t)us;
+}
+
+#define EV_TRACE_RECORD(ev_loop, type, ev, arg0, arg1) \
+	ev_trace_record((ev_loop), (type), (ev_base_t*)(void*)(ev), (arg0), (arg1))
+
+int ev_trace_dump(ev_loop_t *ev_loop, FILE *fp)
+{
+	ev_trace_ring_t *ring = &(ev_loop->trace);
+	int64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	int64_t first = (head>EV_TRACE_RECORD_NUM)?(head-EV_TRACE_RECORD_NUM):0;
+
+	ev_trace_header_t header;
+	header.magic = EV_TRACE_MAGIC;
+	header.record_size = sizeof(ev_trace_record_t);
+	header.record_cnt = head-first;
+	header.stamp_base = ring->stamp_base;
+	header.ns_base = ring->ns_base;
+	header.stamp_dump = get_trace_stamp();
+	header.ns_dump = get_boot_nano_seconds();
+	if(fwrite(&header, sizeof(header), 1, fp)!=1)
+		return -1;
+
+	// 环形存储,最多分两段写出.
+	int64_t first_idx = first&(EV_TRACE_RECORD_NUM-1);
+	int64_t tail_cnt = EV_TRACE_RECORD_NUM-first_idx;
+	if(tail_cnt>header.record_cnt)
+		tail_cnt = header.record_cnt;
+	if(fwrite(&(ring->records[first_idx]), sizeof(ev_trace_record_t), tail_cnt, fp)!=(size_t)tail_cnt)
+		return -1;
+	if(fwrite(&(ring->records[0]), sizeof(ev_trace_record_t), header.record_cnt-tail_cnt, fp)!=(size_t)(header.record_cnt-tail_cnt))
+		return -1;
+	return 0;
+}
+#else
+#define EV_TRACE_RECORD(ev_loop, type, ev, arg0, arg1) do{}while(0)
+#endif
+
 /*************
  * event_loop
  *************/
@@ -47,13 +111,49 @@ void ev_loop_init(ev_loop_t *ev_loop)
 {
 	ev_loop->anfd_cnt = 0;
 	ev_loop->timer_tbl = NULL;
+	ev_loop->timer_ref.seconds = 0;
+	ev_loop->timer_ref.micro_seconds = 0;
+	ev_loop->timer_wakeups = 0;
+	ev_loop->timer_wakeups_saved = 0;
+	ev_loop->timer_wake.seconds = 0;
+	ev_loop->timer_wake.micro_seconds = 0;
+	ev_loop->busy_poll_budget.seconds = 0;
+	ev_loop->busy_poll_budget.micro_seconds = 0;
+	ev_loop->busy_poll_hits = 0;
+	ev_loop->busy_poll_timeouts = 0;
+	ev_loop->busy_poll_blocks = 0;
 	int priority_idx=0;
 	for(;priority_idx<EV_PRIORITY_NUM; ++priority_idx)
 		ev_loop->anpending_cnt[priority_idx] = 0;
+	ev_loop->anready_cnt = 0;
+	ev_loop->backend_fd = -1;
 	install_backend_impl(ev_loop);
+#ifdef EV_TRACE
+	ev_loop->trace.head = 0;
+	ev_loop->trace.stamp_base = get_trace_stamp();
+	ev_loop->trace.ns_base = get_boot_nano_seconds();
+#endif
 }
 
 // anpending成员的操作
+// 在anpendings中插入/删除后,更新该优先级下自from起各事件记录的位置.
+static void ev_loop_pending_reindex(ev_loop_t *ev_loop, int32_t priority_idx, int32_t from)
+{
+	ANPENDING *base = &(ev_loop->anpendings[priority_idx][0]);
+	int32_t i;
+	for(i=from; i<ev_loop->anpending_cnt[priority_idx]; ++i)
+	{
+		if(base[i].event_occur==EV_TIMEOUT)
+		{
+			ev_timer_t *timer = NULL;
+			for(timer=(ev_timer_t*)(base[i].ev); timer; timer=timer->next_ev)
+				timer->pending = i;
+		}else{
+			base[i].ev->pending = i;
+		}
+	}
+}
+
 static void ev_loop_pending_set_io(ev_loop_t *ev_loop, ev_io_t *ev_io, int event_occur)
 {
 	if(ev_is_inactive(ev_io))
@@ -62,7 +162,7 @@ static void ev_loop_pending_set_io(ev_loop_t *ev_loop, ev_io_t *ev_io, int event
 	if(ev_is_pending(ev_io))
 		return;
 
-	int32_t ev_priority = ev_io->priority;
+	int32_t ev_priority = EV_PRIORITY_IDX(ev_io->priority);
 	if(ev_loop->anpending_cnt[ev_priority]>=EV_PRIORITY_PENDING_NUM)
 		FATAL_ERROR("fd %d with priority %d and event 0x%x occur, and exceeds EV_PRIORITY_PENDING_NUM which is %d", ev_io->fd, ev_io->priority, event_occur, EV_PRIORITY_PENDING_NUM);
 
@@ -72,8 +172,13 @@ static void ev_loop_pending_set_io(ev_loop_t *ev_loop, ev_io_t *ev_io, int event
 	BINARY_SEARCH(base, lower, upper, 
 		anpending, event_occur, search_func_between_anpendings_and_events
 	);
-	if(!anpending)
-		FATAL_ERROR("ev_io_event with fd %d, but no position in anpendings.\n", ev_io->fd);
+	// 已有相同事件时插入到其中第一个之前,使backend新报告的事件排在重新就绪的事件之前.
+	if(anpending && anpending->event_occur==event_occur)
+	{
+		lower = anpending-base;
+		while(lower>0 && base[lower-1].event_occur==event_occur)
+			--lower;
+	}
 
 	// 加入到lower位置
 	memmove(&(base[lower+1]), &(base[lower]), sizeof(ANPENDING)*(ev_loop->anpending_cnt[ev_priority]-lower));
@@ -82,6 +187,8 @@ static void ev_loop_pending_set_io(ev_loop_t *ev_loop, ev_io_t *ev_io, int event
 	anpending->event_occur = event_occur;
 	ev_io->pending = lower;
 	++ev_loop->anpending_cnt[ev_priority];
+	EV_TRACE_RECORD(ev_loop, EV_TRACE_PENDING, ev_io, ev_io->fd, event_occur);
+	ev_loop_pending_reindex(ev_loop, ev_priority, lower+1);
 }
 
 static void ev_loop_pending_unset_io(ev_loop_t *ev_loop, ev_io_t *ev_io)
@@ -92,15 +199,63 @@ static void ev_loop_pending_unset_io(ev_loop_t *ev_loop, ev_io_t *ev_io)
 	if(ev_is_not_pending(ev_io))
 		return;
 
-	if(ev_io->pending>=ev_loop->anpending_cnt[ev_io->priority])
-		FATAL_ERROR("internal logic error, ev_io_event pending %d, exceed max-pending-num %d in this priority.\n", ev_io->pending, ev_loop->anpending_cnt[ev_io->priority]);
+	int32_t ev_priority = EV_PRIORITY_IDX(ev_io->priority);
+	if(ev_io->pending>=ev_loop->anpending_cnt[ev_priority])
+		FATAL_ERROR("internal logic error, ev_io_event pending %d, exceed max-pending-num %d in this priority.\n", ev_io->pending, ev_loop->anpending_cnt[ev_priority]);
 
-	ANPENDING *base = &(ev_loop->anpendings[ev_io->priority][0]);
+	ANPENDING *base = &(ev_loop->anpendings[ev_priority][0]);
 	int32_t position = ev_io->pending;
-	int32_t max_position_this_priority = ev_loop->anpending_cnt[ev_io->priority]-1;
+	int32_t max_position_this_priority = ev_loop->anpending_cnt[ev_priority]-1;
 	if(position<max_position_this_priority)
 		memmove(&base[position], &base[position+1], sizeof(ANPENDING)*(max_position_this_priority-position));
-	--ev_loop->anpending_cnt[ev_io->priority];
+	--ev_loop->anpending_cnt[ev_priority];
+	ev_loop_pending_reindex(ev_loop, ev_priority, position);
+}
+
+/*
+ * 边沿触发的ev_io在回调后仍有未读/写尽的事件时,记录到anreadys中,
+ * 于下次循环开始时重新加入pendings(此时backend不会再次报告该事件).
+ */
+static void ev_loop_ready_add(ev_loop_t *ev_loop, ev_io_t *ev_io)
+{
+	int32_t i;
+	for(i=0; i<ev_loop->anready_cnt; ++i)
+		if(ev_loop->anreadys[i]==ev_io)
+			return;
+	if(ev_loop->anready_cnt>=EV_PRIORITY_PENDING_NUM)
+		FATAL_ERROR("fd %d still ready, and exceeds EV_PRIORITY_PENDING_NUM which is %d", ev_io->fd, EV_PRIORITY_PENDING_NUM);
+	ev_loop->anreadys[ev_loop->anready_cnt++] = ev_io;
+}
+
+static void ev_loop_ready_del(ev_loop_t *ev_loop, ev_io_t *ev_io)
+{
+	int32_t i;
+	for(i=0; i<ev_loop->anready_cnt; ++i)
+	{
+		if(ev_loop->anreadys[i]==ev_io)
+		{
+			ev_loop->anreadys[i] = ev_loop->anreadys[--ev_loop->anready_cnt];
+			return;
+		}
+	}
+}
+
+// 返回重新就绪的事件数目.
+static int32_t ev_loop_ready_repend(ev_loop_t *ev_loop)
+{
+	int32_t i, cnt = ev_loop->anready_cnt, repend_cnt = 0;
+	ev_loop->anready_cnt = 0;
+	for(i=0; i<cnt; ++i)
+	{
+		ev_io_t *ev_io = ev_loop->anreadys[i];
+		int32_t event_occur = ev_io->events_ready & ev_io->events_focused;
+		if(ev_is_active(ev_io) && event_occur)
+		{
+			ev_loop_pending_set_io(ev_loop, ev_io, event_occur);
+			++repend_cnt;
+		}
+	}
+	return repend_cnt;
 }
 
 static void ev_loop_pending_set_timer(ev_loop_t *ev_loop, ev_timer_t *ev_timer)
@@ -111,7 +266,7 @@ static void ev_loop_pending_set_timer(ev_loop_t *ev_loop, ev_timer_t *ev_timer)
 	if(ev_is_pending(ev_timer))
 		return;
 
-	int32_t ev_priority = ev_timer->priority;
+	int32_t ev_priority = EV_PRIORITY_IDX(ev_timer->priority);
 	if(ev_loop->anpending_cnt[ev_priority]>=EV_PRIORITY_PENDING_NUM)
 		FATAL_ERROR("ev_timer_event with priority %d occur, and exceeds EV_PRIORITY_PENDING_NUM which is %d", ev_timer->priority, EV_PRIORITY_PENDING_NUM);
 
@@ -121,11 +276,11 @@ static void ev_loop_pending_set_timer(ev_loop_t *ev_loop, ev_timer_t *ev_timer)
 	BINARY_SEARCH(base, lower, upper, 
 		anpending, EV_TIMEOUT, search_func_between_anpendings_and_events
 	);
-	if(!anpending)
-		FATAL_ERROR("ev_timer_event without position in anpendings.\n");
+	if(anpending && anpending->event_occur==EV_TIMEOUT)
+		lower = anpending-base;
 
 	// 加入到lower位置
-	if(base[lower].event_occur==EV_TIMEOUT)
+	if(lower<ev_loop->anpending_cnt[ev_priority] && base[lower].event_occur==EV_TIMEOUT)
 	{
 		anpending = &(base[lower]);
 		if(!anpending->ev)
@@ -139,6 +294,7 @@ static void ev_loop_pending_set_timer(ev_loop_t *ev_loop, ev_timer_t *ev_timer)
 		ev_timer->prev_ev = inserted_timer;
 
 		ev_timer->pending = lower;
+		EV_TRACE_RECORD(ev_loop, EV_TRACE_PENDING, ev_timer, -1, EV_TIMEOUT);
 	}else{
 		memmove(&(base[lower+1]), &(base[lower]), sizeof(ANPENDING)*(ev_loop->anpending_cnt[ev_priority]-lower));
 		anpending = &(base[lower]);
@@ -147,6 +303,8 @@ static void ev_loop_pending_set_timer(ev_loop_t *ev_loop, ev_timer_t *ev_timer)
 
 		ev_timer->pending = lower;
 		++ev_loop->anpending_cnt[ev_priority];
+		EV_TRACE_RECORD(ev_loop, EV_TRACE_PENDING, ev_timer, -1, EV_TIMEOUT);
+		ev_loop_pending_reindex(ev_loop, ev_priority, lower+1);
 	}
 }
 
@@ -158,10 +316,11 @@ static void ev_loop_pending_unset_timer(ev_loop_t *ev_loop, ev_timer_t *ev_timer
 	if(ev_is_not_pending(ev_timer))
 		return;
 
-	if(ev_timer->pending>=ev_loop->anpending_cnt[ev_timer->priority])
-		FATAL_ERROR("internal logic error, ev_timer_event pending %d, exceed max-pending-num %d in this priority.\n", ev_timer->pending, ev_loop->anpending_cnt[ev_timer->priority]);
+	int32_t ev_priority = EV_PRIORITY_IDX(ev_timer->priority);
+	if(ev_timer->pending>=ev_loop->anpending_cnt[ev_priority])
+		FATAL_ERROR("internal logic error, ev_timer_event pending %d, exceed max-pending-num %d in this priority.\n", ev_timer->pending, ev_loop->anpending_cnt[ev_priority]);
 
-	ANPENDING *base = &(ev_loop->anpendings[ev_timer->priority][0]);
+	ANPENDING *base = &(ev_loop->anpendings[ev_priority][0]);
 	int32_t position = ev_timer->pending;
 	if(ev_timer->next_ev)
 		ev_timer->next_ev->prev_ev = ev_timer->prev_ev;
@@ -173,9 +332,10 @@ static void ev_loop_pending_unset_timer(ev_loop_t *ev_loop, ev_timer_t *ev_timer
 	ev_timer->next_ev = NULL;
 	if(!base[position].ev)
 	{
-		int32_t max_position_this_priority = ev_loop->anpending_cnt[ev_timer->priority]-1;
+		int32_t max_position_this_priority = ev_loop->anpending_cnt[ev_priority]-1;
 		memmove(&base[position], &base[position+1], sizeof(ANPENDING)*(max_position_this_priority-position));
-		--ev_loop->anpending_cnt[ev_timer->priority];
+		--ev_loop->anpending_cnt[ev_priority];
+		ev_loop_pending_reindex(ev_loop, ev_priority, position);
 	}
 }
 
@@ -193,10 +353,25 @@ static void check_ev_io_modification(ev_loop_t *ev_loop)
 			int32_t old_events_focused = anfd->events_focused;
 			anfd->events_focused = EV_NONE;
 			ev_io_t *ev_io = NULL;
+			int32_t all_edge = 1;
 			for(ev_io=(ev_io_t*)anfd->head; ev_io; ev_io = ev_io->next_ev)
+			{
 				anfd->events_focused |= ev_io->events_focused;
+				if(!ev_io->edge)
+					all_edge = 0;
+			}
+			if(anfd->events_focused && all_edge)
+				anfd->events_focused |= EV_EDGE;
 			if(old_events_focused != anfd->events_focused)
 				ev_loop->backend_modify(ev_loop, anfd->fd, old_events_focused, anfd->events_focused);
+
+			// 已无ev_io的fd从anfds中移除,避免fd关闭后其位置一直被占用.
+			if(!anfd->head)
+			{
+				memmove(anfd, anfd+1, sizeof(ANFD)*(ev_loop->anfd_cnt-i-1));
+				--ev_loop->anfd_cnt;
+				--i;
+			}
 		}
     }
 }
@@ -208,8 +383,9 @@ void ev_io_event(ev_loop_t *ev_loop, fd_type_t fd, int32_t events)
 	BINARY_SEARCH(&(ev_loop->anfds[0]), lower, upper, current, fd, search_func_between_anfds_and_fd);
 	if(!(current && current->fd==fd))
 		FATAL_ERROR("ev_io_event with fd %d, but this fd not in anfds.\n", fd);
+	EV_TRACE_RECORD(ev_loop, EV_TRACE_IO_EVENT, NULL, fd, events);
 
-	if(current->events_focused & events)
+	if(current->events_focused & events & EV_RW)
 	{
 		ev_io_t *ev_io = current->head;
 		while(ev_io)
@@ -217,6 +393,9 @@ void ev_io_event(ev_loop_t *ev_loop, fd_type_t fd, int32_t events)
 			int32_t event_occur = ev_io->events_focused & events;
 			if(event_occur)
 			{
+				// 边沿触发的事件在读/写尽之前保持就绪.
+				if(ev_io->edge)
+					ev_io->events_ready |= event_occur;
 				// 将该ev_io加入到pendings中,注意仍然保存在anfds中.
 				ev_loop_pending_set_io(ev_loop, ev_io, event_occur);
 			}
@@ -226,8 +405,172 @@ void ev_io_event(ev_loop_t *ev_loop, fd_type_t fd, int32_t events)
 }
 
 
-static void ev_timer_event(ev_loop_t *ev_loop)
+/*
+ * 定时器的合并:从首个定时器起,将窗口([超时时刻, 超时时刻+slack])重叠的定时器归为一组,
+ * 在组内最早的窗口结束时刻唤醒一次,组内定时器在该次唤醒中一并触发.
+ * slack为0的定时器窗口即其超时时刻,仍被严格遵守.
+ *
+ * wake为相对timer_ref的唤醒时刻,返回该组的定时器数目.
+ */
+static int32_t ev_timer_coalesce(ev_loop_t *ev_loop, ev_duration_t *wake)
+{
+	ev_timer_t *timer = ev_loop->timer_tbl;
+	ev_duration_t deadline, window_end, group_end;
+	int32_t group_size = 1;
+
+	memcpy(&deadline, &timer->interval, sizeof(ev_duration_t));
+	memcpy(&group_end, &deadline, sizeof(ev_duration_t));
+	ev_duration_add(group_end, timer->slack);
+	for(timer=timer->next_ev; timer; timer=timer->next_ev)
+	{
+		ev_duration_add(deadline, timer->interval);
+		if(!ev_duration_le(deadline, group_end))
+			break;
+		memcpy(&window_end, &deadline, sizeof(ev_duration_t));
+		ev_duration_add(window_end, timer->slack);
+		if(ev_duration_lt(window_end, group_end))
+			memcpy(&group_end, &window_end, sizeof(ev_duration_t));
+		++group_size;
+	}
+
+	memcpy(wake, &group_end, sizeof(ev_duration_t));
+	return group_size;
+}
+
+// 将到now为止已超时的定时器从timer_tbl移至pendings.
+static void ev_timer_event(ev_loop_t *ev_loop, ev_duration_t *now)
+{
+	if(!ev_loop->timer_tbl)
+	{
+		memcpy(&ev_loop->timer_ref, now, sizeof(ev_duration_t));
+		return;
+	}
+
+	ev_duration_t elapsed;
+	memcpy(&elapsed, now, sizeof(ev_duration_t));
+	ev_duration_sub(elapsed, ev_loop->timer_ref);
+
+	// 计划唤醒时刻及之前的每个不同超时时刻,若不合并都需一次唤醒,本次唤醒只占其一;
+	// 因唤醒延迟才超时的定时器(超时时刻晚于计划唤醒时刻)不计入.
+	int32_t expired = 0, planned = 0;
+	ev_duration_t deadline;
+	memcpy(&deadline, &ev_loop->timer_ref, sizeof(ev_duration_t));
+	ev_timer_t *timer = NULL;
+	while((timer=ev_loop->timer_tbl) && ev_duration_le(timer->interval, elapsed))
+	{
+		ev_duration_sub(elapsed, timer->interval);
+		ev_duration_add(deadline, timer->interval);
+		if(ev_duration_le(deadline, ev_loop->timer_wake)
+			&& (!planned || !ev_duration_is_zero(timer->interval)))
+			++planned;
+		++expired;
+
+		ev_loop->timer_tbl = timer->next_ev;
+		if(ev_loop->timer_tbl)
+			ev_loop->timer_tbl->prev_ev = NULL;
+		timer->prev_ev = NULL;
+		timer->next_ev = NULL;
+		ev_loop_pending_set_timer(ev_loop, timer);
+	}
+	if(ev_loop->timer_tbl)
+		ev_duration_sub(ev_loop->timer_tbl->interval, elapsed);
+	memcpy(&ev_loop->timer_ref, now, sizeof(ev_duration_t));
+
+	if(expired>0)
+	{
+		++ev_loop->timer_wakeups;
+		if(planned>1)
+			ev_loop->timer_wakeups_saved += planned-1;
+	}
+}
+
+// 按优先级从高到低触发已就绪的事件.
+static void ev_loop_invoke_pending(ev_loop_t *ev_loop)
+{
+	int32_t priority_idx;
+	for(priority_idx=0; priority_idx<EV_PRIORITY_NUM; ++priority_idx)
+	{
+		while(ev_loop->anpending_cnt[priority_idx]>0)
+		{
+			ANPENDING *anpending = &(ev_loop->anpendings[priority_idx][0]);
+			if(anpending->event_occur==EV_TIMEOUT)
+			{
+				ev_timer_t *timer = (ev_timer_t*)(anpending->ev);
+				ev_loop_pending_unset_timer(ev_loop, timer);
+				ev_pending_reset(timer);
+				ev_inactivate(timer); // 定时器都为oneshot
+				EV_TRACE_RECORD(ev_loop, EV_TRACE_CB_START, timer, -1, EV_TIMEOUT);
+				if(timer->cb)
+					timer->cb(ev_loop, timer, EV_TIMEOUT);
+				EV_TRACE_RECORD(ev_loop, EV_TRACE_CB_END, timer, -1, EV_TIMEOUT);
+			}else{
+				ev_io_t *ev_io = (ev_io_t*)(anpending->ev);
+				int32_t event_occur = anpending->event_occur;
+				ev_loop_pending_unset_io(ev_loop, ev_io);
+				ev_pending_reset(ev_io);
+				EV_TRACE_RECORD(ev_loop, EV_TRACE_CB_START, ev_io, ev_io->fd, event_occur);
+				if(ev_io->cb)
+					ev_io->cb(ev_loop, ev_io, event_occur);
+				EV_TRACE_RECORD(ev_loop, EV_TRACE_CB_END, ev_io, ev_io->fd, event_occur);
+				if(ev_io->edge && ev_is_active(ev_io) && (ev_io->events_ready & ev_io->events_focused))
+					ev_loop_ready_add(ev_loop, ev_io);
+			}
+		}
+	}
+}
+
+static int32_t ev_loop_pending_num(ev_loop_t *ev_loop)
+{
+	int32_t priority_idx, num = 0;
+	for(priority_idx=0; priority_idx<EV_PRIORITY_NUM; ++priority_idx)
+		num += ev_loop->anpending_cnt[priority_idx];
+	return num;
+}
+
+/*
+ * 以零超时poll自旋至多busy_poll_budget(不超过本次的阻塞时长).
+ * 自旋期间有事件就绪或已到达阻塞时长时返回1,否则将block_duration更新为剩余的阻塞时长并返回0.
+ */
+static int32_t ev_loop_busy_poll(ev_loop_t *ev_loop, ev_duration_t *entry, ev_duration_t *block_duration)
 {
+	if(ev_duration_is_zero(ev_loop->busy_poll_budget))
+		return 0;
+	if(block_duration && ev_duration_is_zero(*block_duration))
+		return 0;
+
+	ev_duration_t spin_end, now, zero;
+	memcpy(&spin_end, entry, sizeof(ev_duration_t));
+	if(block_duration && ev_duration_lt(*block_duration, ev_loop->busy_poll_budget))
+		ev_duration_add(spin_end, (*block_duration));
+	else
+		ev_duration_add(spin_end, ev_loop->busy_poll_budget);
+	zero.seconds = 0;
+	zero.micro_seconds = 0;
+
+	do{
+		ev_loop->backend_poll(ev_loop, &zero);
+		if(ev_loop_pending_num(ev_loop)>0)
+		{
+			++ev_loop->busy_poll_hits;
+			return 1;
+		}
+		get_boot_duration(&now);
+	}while(ev_duration_lt(now, spin_end));
+
+	if(block_duration)
+	{
+		ev_duration_t spent;
+		memcpy(&spent, &now, sizeof(ev_duration_t));
+		ev_duration_sub(spent, (*entry));
+		if(!ev_duration_lt(spent, *block_duration))
+		{
+			++ev_loop->busy_poll_timeouts;
+			return 1;
+		}
+		ev_duration_sub((*block_duration), spent);
+	}
+	++ev_loop->busy_poll_blocks;
+	return 0;
 }
 
 void ev_loop_run(ev_loop_t *ev_loop)
@@ -235,21 +578,46 @@ void ev_loop_run(ev_loop_t *ev_loop)
 	// 检测ev_io的变化
 	check_ev_io_modification(ev_loop);
 
+	// 边沿触发但尚未读/写尽的事件先行就绪,backend中新发生的事件排在其前.
+	int32_t repend_cnt = ev_loop_ready_repend(ev_loop);
+
 	// 获取下次要等待的时间
+	ev_duration_t entry_block,leave_block;
 	ev_duration_t *block_duration_ptr = NULL, block_duration;
+	get_boot_duration(&entry_block);
 	if(ev_loop->timer_tbl)
 	{
-		memcpy(&block_duration, &ev_loop->timer_tbl->interval, sizeof(ev_duration_t));
+		ev_duration_t passed;
+		memcpy(&passed, &entry_block, sizeof(ev_duration_t));
+		ev_duration_sub(passed, ev_loop->timer_ref);
+		ev_timer_coalesce(ev_loop, &block_duration);
+		memcpy(&ev_loop->timer_wake, &ev_loop->timer_ref, sizeof(ev_duration_t));
+		ev_duration_add(ev_loop->timer_wake, block_duration);
+		if(ev_duration_lt(passed, block_duration)){
+			ev_duration_sub(block_duration, passed);
+		}else{
+			block_duration.seconds = 0;
+			block_duration.micro_seconds = 0;
+		}
+		block_duration_ptr = &block_duration;
+	}
+	if(repend_cnt>0)
+	{
+		block_duration.seconds = 0;
+		block_duration.micro_seconds = 0;
 		block_duration_ptr = &block_duration;
 	}
 
 	// 等待事件发生
-	ev_duration_t entry_block,leave_block;
-	get_boot_duration(&entry_block);
-	ev_loop->backend_poll(ev_loop, block_duration_ptr);
+	EV_TRACE_RECORD(ev_loop, EV_TRACE_POLL_ENTER, NULL, ev_trace_block_us(block_duration_ptr), 0);
+	if(!ev_loop_busy_poll(ev_loop, &entry_block, block_duration_ptr))
+		ev_loop->backend_poll(ev_loop, block_duration_ptr);
+	EV_TRACE_RECORD(ev_loop, EV_TRACE_POLL_EXIT, NULL, 0, 0);
 	get_boot_duration(&leave_block);
-	
-	// ...
+
+	// 处理超时的定时器并触发就绪的事件
+	ev_timer_event(ev_loop, &leave_block);
+	ev_loop_invoke_pending(ev_loop);
 }
 
 /***********
@@ -275,8 +643,15 @@ void ev_timer_start(ev_loop_t *ev_loop, ev_timer_t *timer, ev_duration_t *interv
 	// 加入到定时器链表中
 	memcpy(&timer->interval, interval, sizeof(ev_duration_t));
 	if(!ev_loop->timer_tbl){
+		get_boot_duration(&ev_loop->timer_ref);
 		ev_loop->timer_tbl = timer;
 	}else{
+		// interval转换为相对timer_ref
+		ev_duration_t now;
+		get_boot_duration(&now);
+		ev_duration_sub(now, ev_loop->timer_ref);
+		ev_duration_add(timer->interval, now);
+
 		ev_timer_t *after_this = NULL;
 		ev_timer_t *before_this = ev_loop->timer_tbl;
 		do{	
@@ -352,6 +727,9 @@ void ev_io_start(ev_loop_t *ev_loop, ev_io_t *ev_io)
 	{
 		// 更新到current
 		current->refresh = 1;
+		// 该fd上已无ev_io时可能已被关闭并重新打开(如accept得到同号fd),需重新向backend注册.
+		if(!current->head)
+			current->events_focused = EV_NONE;
 		ev_io->next_ev = current->head; // 头部插入
 		ev_io->prev_ev = NULL;
 		if(current->head)
@@ -365,8 +743,11 @@ void ev_io_start(ev_loop_t *ev_loop, ev_io_t *ev_io)
 		++ev_loop->anfd_cnt;
 		current = &(ev_loop->anfds[lower]);
 		current->fd = ev_io->fd;
+		current->events_focused = EV_NONE;
 		current->refresh = 1;
 		current->head = ev_io;
+		ev_io->prev_ev = NULL;
+		ev_io->next_ev = NULL;
 	}
 
 	// activate
@@ -386,6 +767,11 @@ void ev_io_stop(ev_loop_t *ev_loop, ev_io_t *ev_io)
 		ev_loop_pending_unset_io(ev_loop, ev_io);
 		ev_pending_reset(ev_io);
 	}
+	if(ev_io->edge)
+	{
+		ev_loop_ready_del(ev_loop, ev_io);
+		ev_io->events_ready = EV_NONE;
+	}
 
 	// 更新所在的anfd.
 	ANFD *current = NULL;
@@ -410,6 +796,40 @@ void ev_io_stop(ev_loop_t *ev_loop, ev_io_t *ev_io)
 	ev_inactivate(ev_io);
 }
 
+// 修改已启动的ev_io关注的事件,无需从anfds中移除再插入.
+void ev_io_modify(ev_loop_t *ev_loop, ev_io_t *ev_io, int32_t events_focused)
+{
+	events_focused &= EV_RW;
+	if(ev_is_inactive(ev_io))
+	{
+		ev_io->events_focused = events_focused;
+		return;
+	}
+	if(ev_io->events_focused==events_focused)
+		return;
+
+	// 就绪的事件不再被关注时移出pendings
+	if(ev_is_pending(ev_io))
+	{
+		ANPENDING *anpending = &(ev_loop->anpendings[EV_PRIORITY_IDX(ev_io->priority)][ev_io->pending]);
+		if(!(anpending->event_occur & events_focused))
+		{
+			ev_loop_pending_unset_io(ev_loop, ev_io);
+			ev_pending_reset(ev_io);
+		}
+	}
+	ev_io->events_ready &= events_focused;
+
+	ANFD *current = NULL;
+	int32_t lower = 0, upper = ev_loop->anfd_cnt;
+	BINARY_SEARCH(&(ev_loop->anfds[0]), lower, upper, current, ev_io, search_func_between_anfds_and_ev_io);
+	if(!(current && current->fd==ev_io->fd))
+		FATAL_ERROR("internal logic error, ev_io active but not in anfds.\n");
+
+	ev_io->events_focused = events_focused;
+	current->refresh = 1;
+}
+
 /*************
  * ev_prepare
  *************/
@@ -13,7 +13,8 @@ enum ev_mask_t{
 	EV_TIMEOUT = 0x01, // 定时
 	EV_READABLE = 0x02, // 可读
 	EV_WRITABLE = 0x04, // 可写
-	EV_RW = 0x06 // 可读写
+	EV_RW = 0x06, // 可读写
+	EV_EDGE = 0x08 // 边沿触发(仅在backend_modify中与EV_RW组合使用)
 };
 
 /*
@@ -74,6 +75,7 @@ typedef struct ev_base_t{
 #define EV_LOW_PRIORITY 3
 #define EV_DEFAULT_PRIORITY 0
 #define EV_PRIORITY_NUM (EV_LOW_PRIORITY-EV_HIGH_PRIORITY+1)
+#define EV_PRIORITY_IDX(pri) ((pri)-EV_HIGH_PRIORITY) // 优先级在anpendings中的下标
 #define EV_PRIORITY_PENDING_NUM (MAX_FD_NUMS<<1+1)
 
 #define ev_priority_higher_than(ev1, ev2) \
@@ -154,7 +156,7 @@ typedef struct ev_duration_t{
 #define ev_duration_add(a, b) do{ \
 	a.seconds += b.seconds; \
 	a.micro_seconds += b.micro_seconds; \
-	if(a.micro_seconds>MICRO_SECONDS_ONE_SECOND){ \
+	if(a.micro_seconds>=MICRO_SECONDS_ONE_SECOND){ \
 		a.seconds += 1; \
 		a.micro_seconds %= MICRO_SECONDS_ONE_SECOND; \
 	} \
@@ -169,15 +171,31 @@ typedef struct ev_duration_t{
 	} \
 }while(0) \
 
+#define ev_duration_is_zero(a) \
+	(((a).seconds==0) && ((a).micro_seconds==0)) \
+
+/*
+ * interval : 在定时器链表中,相对前一个定时器的超时间隔;
+ * slack : 允许的超时延后量,事件循环会将窗口([超时时刻, 超时时刻+slack])重叠的定时器
+ *         合并为一次唤醒.默认为0,即严格按超时时刻触发(如扫描周期).
+ */
 typedef struct ev_timer_t{
 	EV_LIST(ev_timer_t)
 	ev_duration_t interval; 
+	ev_duration_t slack;
 }ev_timer_t;
 
 #define ev_timer_init(ev, cb) do{ \
 	ev_list_init(ev, cb); \
 	((ev_timer_t*)(void*)(ev))->interval.seconds = 0; \
 	((ev_timer_t*)(void*)(ev))->interval.micro_seconds = 0; \
+	((ev_timer_t*)(void*)(ev))->slack.seconds = 0; \
+	((ev_timer_t*)(void*)(ev))->slack.micro_seconds = 0; \
+}while(0) \
+
+#define ev_timer_set_slack(ev, slack_) do{ \
+	if(ev_is_inactive(ev)) \
+		memcpy(&((ev_timer_t*)(void*)(ev))->slack, (slack_), sizeof(ev_duration_t)); \
 }while(0) \
 
 void ev_timer_start(struct ev_loop_t *ev_loop, ev_timer_t *timer, ev_duration_t *interval);
@@ -185,11 +203,22 @@ void ev_timer_stop(struct ev_loop_t *ev_loop, ev_timer_t *timer);
 
 /*
  * ev_io : io事件.
+ *
+ * 默认为水平触发.设置为边沿触发(ev_io_set_edge)后:
+ * edge : 是否边沿触发,fd上所有ev_io均为边沿触发时,backend才以边沿方式(EPOLLET)关注该fd;
+ * budget : 每次循环中回调的读/写预算,回调读写至多budget次后返回;
+ * events_ready : 已触发但尚未读/写尽的事件,回调遇到EAGAIN时以ev_io_clear_ready清除,
+ *                未清除的事件在下次循环中重新就绪,与同优先级的其他事件轮流处理.
  */
+#define EV_IO_DEFAULT_BUDGET 16
+
 typedef struct ev_io_t{
 	EV_LIST(ev_io_t);
 	fd_type_t fd;
 	int32_t events_focused;
+	int32_t edge;
+	int32_t budget;
+	int32_t events_ready;
 }ev_io_t;
 
 #define ev_io_set(ev, fd_, events_focused_) do{  \
@@ -200,10 +229,26 @@ typedef struct ev_io_t{
 #define ev_io_init(ev, cb, fd, events_focused) do{ \
 	ev_init((ev), (cb)); \
 	ev_io_set((ev), (fd), (events_focused)); \
+	(ev)->edge = 0; \
+	(ev)->budget = EV_IO_DEFAULT_BUDGET; \
+	(ev)->events_ready = EV_NONE; \
+}while(0) \
+
+#define ev_io_set_edge(ev, budget_) do{ \
+	if(ev_is_inactive(ev)) \
+	{ \
+		(ev)->edge = 1; \
+		(ev)->budget = ((budget_)>0)?(budget_):EV_IO_DEFAULT_BUDGET; \
+	} \
+}while(0) \
+
+#define ev_io_clear_ready(ev, events) do{ \
+	(ev)->events_ready &= ~(events); \
 }while(0) \
 
 void ev_io_start(struct ev_loop_t *ev_loop, ev_io_t *ev_io);
 void ev_io_stop(struct ev_loop_t *ev_loop, ev_io_t *ev_io);
+void ev_io_modify(struct ev_loop_t *ev_loop, ev_io_t *ev_io, int32_t events_focused);
 
 /*
  * ev_prepare : prepare事件(一次事件循环阻塞前)
@@ -242,18 +287,101 @@ typedef struct ANPENDING
 	int32_t event_occur; // 发生的事件
 }ANPENDING; // 已就绪事件维护结构
 
+/*
+ * ev_trace : 二进制事件跟踪环(编译时定义EV_TRACE启用).
+ *
+ * 单生产者(事件循环线程)写入,无锁,固定大小,满后覆盖最早的记录.
+ * stamp为port层的时间戳(x86上为tsc),由头部的两组(stamp, ns)对换算为ns;
+ * 由ev_trace_dump导出,trace_dump工具转换为Chrome trace/Perfetto JSON.
+ */
+#ifdef EV_TRACE
+#ifndef EV_TRACE_RECORD_NUM
+#define EV_TRACE_RECORD_NUM 4096 // 须为2的幂
+#endif
+// 环以&(EV_TRACE_RECORD_NUM-1)取下标,非2的幂时编译失败.
+typedef char ev_trace_record_num_pow2[
+	(EV_TRACE_RECORD_NUM<=0 || (EV_TRACE_RECORD_NUM&(EV_TRACE_RECORD_NUM-1)))?-1:1];
+
+enum ev_trace_type_t{
+	EV_TRACE_POLL_ENTER = 1, // arg0 : 阻塞时长(us),-1为不限,超出int32范围时截断
+	EV_TRACE_POLL_EXIT, 
+	EV_TRACE_IO_EVENT, // arg0 : fd, arg1 : 事件
+	EV_TRACE_PENDING, // name : 事件, arg1 : 就绪的事件
+	EV_TRACE_CB_START, // name : 事件, arg1 : 就绪的事件
+	EV_TRACE_CB_END // name : 事件
+};
+
+typedef struct ev_trace_record_t{
+	int64_t stamp;
+	int32_t type;
+	int32_t arg0;
+	int32_t arg1;
+	int8_t name[32];
+}ev_trace_record_t;
+
+#define EV_TRACE_MAGIC 0x45565452 // "EVTR"
+
+typedef struct ev_trace_header_t{
+	int32_t magic;
+	int32_t record_size;
+	int64_t record_cnt; // 其后的记录数目
+	int64_t stamp_base; // 跟踪开始时的(stamp, ns)
+	int64_t ns_base;
+	int64_t stamp_dump; // 导出时的(stamp, ns)
+	int64_t ns_dump;
+}ev_trace_header_t;
+
+typedef struct ev_trace_ring_t{
+	int64_t head; // 已写入的记录总数
+	int64_t stamp_base;
+	int64_t ns_base;
+	struct ev_trace_record_t records[EV_TRACE_RECORD_NUM];
+}ev_trace_ring_t;
+#endif
+
 typedef struct ev_loop_t{
 	struct ANFD anfds[MAX_FD_NUMS]; // io事件(按fd顺序排列)
 	int32_t anfd_cnt;
 	struct ev_timer_t *timer_tbl; // timer事件
+	struct ev_duration_t timer_ref; // timer_tbl中首个定时器interval的参考时刻
+	int32_t timer_wakeups; // 因定时器超时而处理的唤醒次数
+	struct ev_duration_t timer_wake; // 本次poll前按合并计划的定时器唤醒时刻
+	int32_t timer_wakeups_saved; // 因slack合并而节省的唤醒次数
+	struct ev_duration_t busy_poll_budget; // 阻塞前以零超时poll自旋的时长,为0时不自旋
+	int64_t busy_poll_hits; // 自旋期间有事件就绪而无需阻塞的次数
+	int64_t busy_poll_timeouts; // 自旋期间未有事件就绪但已到达阻塞时长(如下一定时器)的次数
+	int64_t busy_poll_blocks; // 自旋未等到事件而转入阻塞的次数
 	struct ANPENDING anpendings[EV_PRIORITY_NUM][EV_PRIORITY_PENDING_NUM]; // 已就绪的事件
 	int32_t anpending_cnt[EV_PRIORITY_NUM];
+	struct ev_io_t *anreadys[EV_PRIORITY_PENDING_NUM]; // 边沿触发且尚未读/写尽的io事件
+	int32_t anready_cnt;
+	fd_type_t backend_fd; // reactor实现自身使用的描述符(如epoll),不使用时为-1
+	fd_type_t backend_max_fd; // reactor实现可关注的最大描述符,更大的fd不能用于ev_io
 	void (*backend_modify)(struct ev_loop_t*, fd_type_t, int32_t, int32_t); // reactor实现
 	void (*backend_poll)(struct ev_loop_t*, struct ev_duration_t*);
+#ifdef EV_TRACE
+	struct ev_trace_ring_t trace;
+#endif
 }ev_loop_t;
 
 void ev_loop_init(ev_loop_t *ev_loop);
 void ev_loop_run(ev_loop_t *ev_loop);
 
+/*
+ * 低时延模式:每次循环在阻塞等待前,先以零超时poll自旋至多budget,
+ * 以CPU占用换取省去阻塞/唤醒的时延,适用于独占核的部署.
+ */
+#define ev_loop_set_busy_poll(ev_loop, budget) do{ \
+	memcpy(&(ev_loop)->busy_poll_budget, (budget), sizeof(ev_duration_t)); \
+}while(0) \
+
+#ifdef EV_TRACE
+/*
+ * 按时间顺序导出跟踪环中的记录(ev_trace_header_t + 记录),成功返回0.
+ * 应在事件循环线程中(如周期超出时)或事件循环停止后调用.
+ */
+int ev_trace_dump(ev_loop_t *ev_loop, FILE *fp);
+#endif
+
 #endif
 
@@ -0,0 +1,195 @@
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // sched_setaffinity
+#endif
+#endif
+
+#include "executor.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define NANO_SECONDS_ONE_SECOND 1000000000L
+
+// 预先触及的栈大小
+#define EV_EXECUTOR_STACK_PREFAULT (64*1024)
+
+static void timespec_add_duration(struct timespec *ts, ev_duration_t *d)
+{
+	ts->tv_sec += d->seconds;
+	ts->tv_nsec += (long)(d->micro_seconds)*1000;
+	while(ts->tv_nsec>=NANO_SECONDS_ONE_SECOND)
+	{
+		ts->tv_nsec -= NANO_SECONDS_ONE_SECOND;
+		ts->tv_sec += 1;
+	}
+}
+
+// a-b,单位ns
+static int64_t timespec_diff_ns(struct timespec *a, struct timespec *b)
+{
+	return (int64_t)(a->tv_sec-b->tv_sec)*NANO_SECONDS_ONE_SECOND + (a->tv_nsec-b->tv_nsec);
+}
+
+// EV_HIGH_PRIORITY..EV_LOW_PRIORITY线性映射为SCHED_FIFO的max..min.
+static int executor_fifo_priority(int32_t priority)
+{
+	int max_prio = sched_get_priority_max(SCHED_FIFO);
+	int min_prio = sched_get_priority_min(SCHED_FIFO);
+	if(priority<EV_HIGH_PRIORITY)
+		priority = EV_HIGH_PRIORITY;
+	else if(priority>EV_LOW_PRIORITY)
+		priority = EV_LOW_PRIORITY;
+	return max_prio - EV_PRIORITY_IDX(priority)*(max_prio-min_prio)/(EV_PRIORITY_NUM-1);
+}
+
+static void executor_prefault_stack()
+{
+	volatile int8_t stack[EV_EXECUTOR_STACK_PREFAULT];
+	int32_t i;
+	for(i=0; i<EV_EXECUTOR_STACK_PREFAULT; i+=64)
+		stack[i] = 0;
+	__asm__ __volatile__("" : : "r"(stack) : "memory");
+}
+
+// 逐页读写一遍,使事件循环的静态存储在进入周期前完成缺页.
+static void executor_prefault_storage(void *storage, size_t size)
+{
+	volatile int8_t *p = (volatile int8_t*)storage;
+	long page_size = sysconf(_SC_PAGESIZE);
+	size_t i;
+	for(i=0; i<size; i+=page_size)
+		p[i] = p[i];
+	if(size>0)
+		p[size-1] = p[size-1];
+}
+
+int ev_executor_setup(ev_executor_t *executor)
+{
+	int ret = 0;
+
+	if(executor->cpu>=0)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(executor->cpu, &cpus);
+		if(sched_setaffinity(0, sizeof(cpus), &cpus))
+		{
+			fprintf(stderr, "failed to pin executor to cpu %d, errno %d\n", executor->cpu, errno);
+			ret = -1;
+		}
+	}
+
+	struct sched_param param;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = executor_fifo_priority(executor->priority);
+	if(sched_setscheduler(0, SCHED_FIFO, &param))
+	{
+		fprintf(stderr, "failed to set SCHED_FIFO priority %d, errno %d\n", param.sched_priority, errno);
+		ret = -1;
+	}
+
+	if(mlockall(MCL_CURRENT|MCL_FUTURE))
+	{
+		fprintf(stderr, "failed to lock memory, errno %d\n", errno);
+		ret = -1;
+	}
+
+	executor_prefault_stack();
+	executor_prefault_storage(executor->ev_loop, sizeof(ev_loop_t));
+	executor_prefault_storage(executor, sizeof(ev_executor_t));
+
+	return ret;
+}
+
+static void on_io_window_closed(ev_loop_t *ev_loop, ev_timer_t *timer, int events)
+{
+	((ev_executor_t*)(timer->data))->io_window_closed = 1;
+}
+
+void ev_executor_run(ev_executor_t *executor)
+{
+	struct timespec boundary, now;
+	int64_t cycle_ns = (int64_t)(executor->cycle.seconds)*NANO_SECONDS_ONE_SECOND + 
+		(int64_t)(executor->cycle.micro_seconds)*1000;
+	int64_t guard_ns = (int64_t)(executor->io_guard.seconds)*NANO_SECONDS_ONE_SECOND + 
+		(int64_t)(executor->io_guard.micro_seconds)*1000;
+	if(cycle_ns<=0)
+		FATAL_ERROR("executor cycle must be positive.\n");
+
+	ev_timer_init(&executor->io_window_timer, on_io_window_closed);
+	ev_set_priority(&executor->io_window_timer, EV_HIGH_PRIORITY);
+	executor->io_window_timer.data = executor;
+
+	if(clock_gettime(CLOCK_MONOTONIC, &boundary))
+		FATAL_ERROR("failed to get actual time, errno %d\n", errno);
+	timespec_add_duration(&boundary, &executor->cycle);
+
+	executor->running = 1;
+	while(executor->running)
+	{
+		// 等待周期边界
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &boundary, NULL)==EINTR);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		int64_t jitter_ns = timespec_diff_ns(&now, &boundary);
+		executor->jitter_last_ns = jitter_ns;
+		if(executor->jitter_last_ns>executor->jitter_max_ns)
+			executor->jitter_max_ns = executor->jitter_last_ns;
+		executor->jitter_sum_ns += jitter_ns;
+		++executor->cycles;
+
+		struct timespec wake = now;
+		timespec_add_duration(&boundary, &executor->cycle);
+
+		// 扫描
+		if(executor->scan)
+			executor->scan(executor);
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		int64_t scan_ns = timespec_diff_ns(&now, &wake);
+		if(scan_ns>executor->scan_max_ns)
+			executor->scan_max_ns = scan_ns;
+
+		// 在剩余时间内运行事件循环,距下一边界io_guard时停止.
+		int64_t remain_ns = timespec_diff_ns(&boundary, &now)-guard_ns;
+		if(remain_ns>0)
+		{
+			ev_duration_t window;
+			window.seconds = (int32_t)(remain_ns/NANO_SECONDS_ONE_SECOND);
+			window.micro_seconds = (int32_t)((remain_ns%NANO_SECONDS_ONE_SECOND)/1000);
+			executor->io_window_closed = 0;
+			ev_timer_start(executor->ev_loop, &executor->io_window_timer, &window);
+			while(!executor->io_window_closed && executor->running)
+				ev_loop_run(executor->ev_loop);
+			ev_timer_stop(executor->ev_loop, &executor->io_window_timer);
+
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			int64_t overshoot_ns = timespec_diff_ns(&now, &boundary)+guard_ns;
+			if(overshoot_ns>executor->io_overshoot_max_ns)
+				executor->io_overshoot_max_ns = overshoot_ns;
+		}
+
+		// 超出周期:跳过已错过的边界,重新对齐.
+		if(timespec_diff_ns(&now, &boundary)>0)
+		{
+			++executor->overruns;
+			while(timespec_diff_ns(&now, &boundary)>0)
+			{
+				timespec_add_duration(&boundary, &executor->cycle);
+				++executor->cycles_skipped;
+			}
+		}
+	}
+}
+
+void ev_executor_stop(ev_executor_t *executor)
+{
+	executor->running = 0;
+}
+#endif
+
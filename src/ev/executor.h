@@ -0,0 +1,67 @@
+
+#ifndef _EXECUTOR_H_
+#define _EXECUTOR_H_
+
+#include "ev.h"
+
+/*
+ * ev_executor : 实时扫描周期执行器(linux).
+ *
+ * 以固定周期执行扫描,周期边界由clock_nanosleep(TIMER_ABSTIME)确定,
+ * 每个周期扫描结束后至下一边界前io_guard的时间段内运行事件循环,处理io/定时事件.
+ *
+ * ev_loop : 所驱动的事件循环;
+ * cpu : 绑定的cpu,<0表示不绑定;
+ * priority : EV_HIGH_PRIORITY..EV_LOW_PRIORITY,映射为SCHED_FIFO优先级;
+ * cycle : 扫描周期;
+ * io_guard : 周期边界前停止运行事件循环的提前量;
+ * scan : 每个周期执行的扫描;
+ * data : 自定义数据.
+ */
+typedef struct ev_executor_t{
+	ev_loop_t *ev_loop;
+	int32_t cpu;
+	int32_t priority;
+	ev_duration_t cycle;
+	ev_duration_t io_guard;
+	void (*scan)(struct ev_executor_t *executor);
+	void *data;
+
+	int32_t running;
+	int32_t io_window_closed;
+	ev_timer_t io_window_timer; // 事件循环运行窗口的结束
+
+	// 统计
+	int64_t cycles; // 已执行的周期数
+	int64_t overruns; // 超出周期的次数
+	int64_t cycles_skipped; // 因超出周期而跳过的周期数
+	int64_t jitter_last_ns; // 实际唤醒相对周期边界的延迟
+	int64_t jitter_max_ns;
+	int64_t jitter_sum_ns;
+	int64_t scan_max_ns; // 唤醒至扫描结束的最大耗时
+	int64_t io_overshoot_max_ns; // 事件循环超出其运行窗口(下一边界前io_guard)返回的最大时长
+}ev_executor_t;
+
+#define ev_executor_init(executor, ev_loop_, scan_, cycle_) do{ \
+	memset((executor), 0, sizeof(ev_executor_t)); \
+	(executor)->ev_loop = (ev_loop_); \
+	(executor)->cpu = -1; \
+	(executor)->priority = EV_HIGH_PRIORITY; \
+	(executor)->scan = (scan_); \
+	memcpy(&(executor)->cycle, (cycle_), sizeof(ev_duration_t)); \
+	(executor)->io_guard.seconds = 0; \
+	(executor)->io_guard.micro_seconds = 200; \
+}while(0) \
+
+/*
+ * 实时化当前线程:绑定cpu、设置SCHED_FIFO优先级、锁定内存并预先触及栈和ev_loop存储.
+ * 各项均尝试执行,任一项失败返回-1(权限不足时执行器仍可以普通调度运行).
+ */
+int ev_executor_setup(ev_executor_t *executor);
+
+// 在当前线程中运行,直到ev_executor_stop.
+void ev_executor_run(ev_executor_t *executor);
+void ev_executor_stop(ev_executor_t *executor);
+
+#endif
+
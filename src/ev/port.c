@@ -11,5 +11,15 @@ void get_boot_duration(ev_duration_t *duration)
 	duration->seconds = val.tv_sec;
 	duration->micro_seconds = val.tv_nsec/1000;
 }
+
+#ifdef EV_TRACE
+int64_t get_boot_nano_seconds()
+{
+	struct timespec val;
+	if(clock_gettime(CLOCK_MONOTONIC, &val))
+		FATAL_ERROR("failed to get actual time, errno %d\n", errno);
+	return (int64_t)val.tv_sec*1000000000L + val.tv_nsec;
+}
+#endif
 #endif
 
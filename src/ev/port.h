@@ -5,6 +5,25 @@
 
 extern void install_backend_impl(ev_loop_t *ev_loop);
 extern void get_boot_duration(ev_duration_t *duration);
+extern void ev_io_event(ev_loop_t *ev_loop, fd_type_t fd, int32_t events);
+
+#ifdef EV_TRACE
+extern int64_t get_boot_nano_seconds();
+
+// 跟踪记录的时间戳,须尽可能廉价.
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline int64_t get_trace_stamp()
+{
+	return (int64_t)__rdtsc();
+}
+#else
+static inline int64_t get_trace_stamp()
+{
+	return get_boot_nano_seconds();
+}
+#endif
+#endif
 
 #endif
 
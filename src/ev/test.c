@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "ev.h"
+#include "port.h"
 
 #ifdef EV_TIMER_TEST
 static void show_timer(ev_timer_t *timer)
@@ -82,10 +83,282 @@ static void test_timer()
 }
 #endif
 
+#ifdef EV_TIMER_COALESCE_TEST
+static int32_t fired_num = 0;
+
+static void on_coalesce_timeout(ev_loop_t *ev_loop, ev_timer_t *timer, int events)
+{
+	ev_duration_t now, *deadline = (ev_duration_t*)timer->data;
+	get_boot_duration(&now);
+	ev_duration_sub(now, (*deadline));
+	fprintf(stdout, "%s fired %d s, %d us after deadline (slack %d us)\n", 
+		timer->name, now.seconds, now.micro_seconds, timer->slack.micro_seconds
+	);
+	++fired_num;
+}
+
+static void test_timer_coalesce()
+{
+	ev_loop_t ev_loop;
+	ev_loop_init(&ev_loop);
+
+	// 前8个为带slack的响应超时,最后一个为严格的扫描周期.
+	ev_timer_t timers[9];
+	ev_duration_t deadlines[9];
+	int32_t timers_num = sizeof(timers)/sizeof(timers[0]);
+
+	int32_t i;
+	for(i=0; i<timers_num; ++i)
+	{
+		ev_timer_t *timer = &timers[i];
+		ev_timer_init(timer, on_coalesce_timeout);
+		ev_duration_t d, slack;
+		if(i<timers_num-1){
+			sprintf(timer->name, "response%d", i+1);
+			d.seconds = 0; d.micro_seconds = 10000+i*500;
+			slack.seconds = 0; slack.micro_seconds = 5000;
+		}else{
+			sprintf(timer->name, "scan");
+			d.seconds = 0; d.micro_seconds = 12000;
+			slack.seconds = 0; slack.micro_seconds = 0;
+		}
+		ev_timer_set_slack(timer, &slack);
+		get_boot_duration(&deadlines[i]);
+		ev_duration_add(deadlines[i], d);
+		timer->data = &deadlines[i];
+		ev_timer_start(&ev_loop, timer, &d);
+	}
+
+	while(fired_num<timers_num)
+		ev_loop_run(&ev_loop);
+
+	// 节省的唤醒与实际唤醒之和不能超过不同超时时刻的数目.
+	int32_t j, distinct = 0;
+	for(i=0; i<timers_num; ++i)
+	{
+		for(j=0; j<i && !ev_duration_eq(deadlines[j], deadlines[i]); ++j);
+		if(j==i)
+			++distinct;
+	}
+	fprintf(stdout, "%d timers, %d deadlines, %d wakeups, %d wakeups saved : %s\n", 
+		timers_num, distinct, ev_loop.timer_wakeups, ev_loop.timer_wakeups_saved, 
+		(ev_loop.timer_wakeups+ev_loop.timer_wakeups_saved<=distinct)?"ok":"FAILED"
+	);
+}
+#endif
+
+#ifdef EV_EXECUTOR_TEST
+#include "executor.h"
+
+static void on_scan(ev_executor_t *executor)
+{
+	if(executor->cycles>=1000)
+		ev_executor_stop(executor);
+}
+
+static void test_executor()
+{
+	static ev_loop_t ev_loop;
+	ev_loop_init(&ev_loop);
+
+	static ev_executor_t executor;
+	ev_duration_t cycle;
+	cycle.seconds = 0; cycle.micro_seconds = 1000;
+	ev_executor_init(&executor, &ev_loop, on_scan, &cycle);
+	executor.cpu = 0;
+	if(ev_executor_setup(&executor))
+		fprintf(stdout, "executor runs without full real-time setup\n");
+
+	ev_executor_run(&executor);
+	fprintf(stdout, "%lld cycles, %lld overruns, %lld skipped, jitter max %lld ns avg %lld ns, "
+		"scan max %lld ns, io overshoot max %lld ns\n", 
+		(long long)executor.cycles, (long long)executor.overruns, (long long)executor.cycles_skipped, 
+		(long long)executor.jitter_max_ns, 
+		(long long)(executor.cycles>0?executor.jitter_sum_ns/executor.cycles:0), 
+		(long long)executor.scan_max_ns, (long long)executor.io_overshoot_max_ns
+	);
+}
+#endif
+
+#ifdef EV_TRACE_TEST
+// 需同时定义EV_TRACE编译.
+static void test_trace()
+{
+	static ev_loop_t ev_loop;
+	ev_loop_init(&ev_loop);
+
+	ev_timer_t timers[3];
+	int32_t i;
+	for(i=0; i<3; ++i)
+	{
+		ev_duration_t d;
+		d.seconds = 0; d.micro_seconds = 1000*(i+1);
+		ev_timer_init(&timers[i], NULL);
+		sprintf(timers[i].name, "timer%d", i+1);
+		ev_timer_start(&ev_loop, &timers[i], &d);
+	}
+	while(ev_loop.timer_tbl)
+		ev_loop_run(&ev_loop);
+
+	FILE *fp = fopen("trace.bin", "wb");
+	if(!fp || ev_trace_dump(&ev_loop, fp))
+		FATAL_ERROR("failed to dump trace.\n");
+	fclose(fp);
+	fprintf(stdout, "%lld records dumped to trace.bin\n", (long long)ev_loop.trace.head);
+}
+#endif
+
+#ifdef EV_EDGE_TEST
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+// 每次读1字节,至多读budget次,遇到EAGAIN时清除就绪.
+static void on_edge_readable(ev_loop_t *ev_loop, ev_io_t *ev_io, int events)
+{
+	int32_t *total = (int32_t*)ev_io->data;
+	int32_t i, n = 0;
+	char c;
+	for(i=0; i<ev_io->budget; ++i)
+	{
+		if(read(ev_io->fd, &c, 1)==1){
+			++n;
+		}else{
+			if(errno==EAGAIN)
+				ev_io_clear_ready(ev_io, EV_READABLE);
+			break;
+		}
+	}
+	*total += n;
+	fprintf(stdout, "%s read %d bytes, total %d\n", ev_io->name, n, *total);
+}
+
+static void test_edge()
+{
+	static ev_loop_t ev_loop;
+	ev_loop_init(&ev_loop);
+
+	// hot连接一次写入大量数据,cold连接少量数据,两者同优先级.
+	int hot[2], cold[2];
+	if(pipe(hot) || pipe(cold))
+		FATAL_ERROR("pipe failed.\n");
+	fcntl(hot[0], F_SETFL, O_NONBLOCK);
+	fcntl(cold[0], F_SETFL, O_NONBLOCK);
+	char buf[64];
+	memset(buf, 'x', sizeof(buf));
+	write(hot[1], buf, sizeof(buf));
+	write(cold[1], buf, 3);
+
+	int32_t hot_total = 0, cold_total = 0;
+	ev_io_t hot_io, cold_io;
+	ev_io_init(&hot_io, on_edge_readable, hot[0], EV_READABLE);
+	ev_io_set_edge(&hot_io, 8);
+	sprintf(hot_io.name, "hot");
+	hot_io.data = &hot_total;
+	ev_io_init(&cold_io, on_edge_readable, cold[0], EV_READABLE);
+	ev_io_set_edge(&cold_io, 8);
+	sprintf(cold_io.name, "cold");
+	cold_io.data = &cold_total;
+	ev_io_start(&ev_loop, &hot_io);
+	ev_io_start(&ev_loop, &cold_io);
+
+	while(hot_total<(int32_t)sizeof(buf) || cold_total<3)
+		ev_loop_run(&ev_loop);
+	fprintf(stdout, "hot drained %d, cold drained %d\n", hot_total, cold_total);
+}
+#endif
+
+#ifdef EV_CORO_TEST
+#include <unistd.h>
+#include <sys/socket.h>
+#include "coro.h"
+
+// 从站:丢弃第一个请求,之后原样回复.
+static void on_slave_readable(ev_loop_t *ev_loop, ev_io_t *ev_io, int events)
+{
+	static int32_t received = 0;
+	char buf[16];
+	ssize_t n = read(ev_io->fd, buf, sizeof(buf));
+	if(n>0 && ++received>1)
+		write(ev_io->fd, buf, n);
+}
+
+typedef struct master_txn_t{
+	fd_type_t fd;
+	int32_t retry;
+	int32_t ok;
+}master_txn_t;
+
+// 主站交互:发送请求,等待响应或超时,超时重试至多3次.
+static void master_txn(ev_coro_t *coro)
+{
+	master_txn_t *txn = (master_txn_t*)coro->data;
+	ev_duration_t timeout;
+	timeout.seconds = 0; timeout.micro_seconds = 20000;
+
+	EV_CORO_BEGIN(coro);
+	for(txn->retry=0; txn->retry<3; ++txn->retry)
+	{
+		write(txn->fd, "req", 3);
+		EV_CORO_AWAIT_ANY(coro, txn->fd, EV_READABLE, &timeout);
+		if(coro->events & EV_READABLE)
+		{
+			char buf[16];
+			if(read(txn->fd, buf, sizeof(buf))==3)
+			{
+				txn->ok = 1;
+				break;
+			}
+		}
+		fprintf(stdout, "master attempt %d timeout\n", txn->retry+1);
+	}
+	EV_CORO_END(coro);
+}
+
+static void test_coro()
+{
+	static ev_loop_t ev_loop;
+	ev_loop_init(&ev_loop);
+
+	int fds[2];
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+		FATAL_ERROR("socketpair failed.\n");
+
+	ev_io_t slave_io;
+	ev_io_init(&slave_io, on_slave_readable, fds[1], EV_READABLE);
+	ev_io_start(&ev_loop, &slave_io);
+
+	master_txn_t txn;
+	txn.fd = fds[0];
+	txn.ok = 0;
+	ev_coro_t coro;
+	ev_coro_init(&coro, master_txn, &txn);
+	ev_coro_start(&ev_loop, &coro);
+	while(!coro.done)
+		ev_loop_run(&ev_loop);
+	fprintf(stdout, "master transaction %s after %d attempts\n", txn.ok?"ok":"failed", txn.retry+1);
+}
+#endif
+
 int main()
 {
 #ifdef EV_TIMER_TEST
 	test_timer();
+#endif
+#ifdef EV_TIMER_COALESCE_TEST
+	test_timer_coalesce();
+#endif
+#ifdef EV_EXECUTOR_TEST
+	test_executor();
+#endif
+#ifdef EV_TRACE_TEST
+	test_trace();
+#endif
+#ifdef EV_EDGE_TEST
+	test_edge();
+#endif
+#ifdef EV_CORO_TEST
+	test_coro();
 #endif
 	return 0;
 }
@@ -0,0 +1,91 @@
+/*
+ * trace_dump : 将ev_trace_dump导出的二进制跟踪记录转换为Chrome trace/Perfetto JSON.
+ *
+ * 用法 : trace_dump [trace.bin] > trace.json
+ */
+#include <stdio.h>
+#ifndef EV_TRACE
+#define EV_TRACE
+#endif
+#include "ev.h"
+
+static double stamp_to_us(ev_trace_header_t *header, int64_t stamp)
+{
+	double ns_per_stamp = 1.0;
+	if(header->stamp_dump!=header->stamp_base)
+		ns_per_stamp = (double)(header->ns_dump-header->ns_base)/(double)(header->stamp_dump-header->stamp_base);
+	return (double)(stamp-header->stamp_base)*ns_per_stamp/1000.0;
+}
+
+static void dump_name(ev_trace_record_t *record, char *name, size_t size)
+{
+	if(record->name[0])
+		snprintf(name, size, "%.*s", (int)sizeof(record->name), (const char*)record->name);
+	else if(record->arg0>=0)
+		snprintf(name, size, "fd %d", record->arg0);
+	else
+		snprintf(name, size, "timer");
+
+	// 避免破坏JSON字符串
+	for(; *name; ++name)
+		if(*name=='"' || *name=='\\' || (unsigned char)(*name)<0x20)
+			*name = '_';
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *fp = stdin;
+	if(argc>1 && !(fp=fopen(argv[1], "rb")))
+		FATAL_ERROR("failed to open %s\n", argv[1]);
+
+	ev_trace_header_t header;
+	if(fread(&header, sizeof(header), 1, fp)!=1 || header.magic!=EV_TRACE_MAGIC)
+		FATAL_ERROR("not an ev trace.\n");
+	if(header.record_size!=sizeof(ev_trace_record_t))
+		FATAL_ERROR("record size %d mismatch, expect %d.\n", header.record_size, (int)sizeof(ev_trace_record_t));
+
+	fprintf(stdout, "{\"traceEvents\":[\n");
+	int64_t i;
+	for(i=0; i<header.record_cnt; ++i)
+	{
+		ev_trace_record_t record;
+		if(fread(&record, sizeof(record), 1, fp)!=1)
+			FATAL_ERROR("trace truncated at record %lld.\n", (long long)i);
+
+		char name[40];
+		double ts = stamp_to_us(&header, record.stamp);
+		const char *sep = (i+1<header.record_cnt)?",":"";
+		switch(record.type)
+		{
+		case EV_TRACE_POLL_ENTER:
+			fprintf(stdout, "{\"name\":\"poll\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"timeout_us\":%d}}%s\n", ts, record.arg0, sep);
+			break;
+		case EV_TRACE_POLL_EXIT:
+			fprintf(stdout, "{\"name\":\"poll\",\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":1}%s\n", ts, sep);
+			break;
+		case EV_TRACE_IO_EVENT:
+			fprintf(stdout, "{\"name\":\"io_event\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"fd\":%d,\"events\":%d}}%s\n", ts, record.arg0, record.arg1, sep);
+			break;
+		case EV_TRACE_PENDING:
+			dump_name(&record, name, sizeof(name));
+			fprintf(stdout, "{\"name\":\"pending %s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"events\":%d}}%s\n", name, ts, record.arg1, sep);
+			break;
+		case EV_TRACE_CB_START:
+			dump_name(&record, name, sizeof(name));
+			fprintf(stdout, "{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"events\":%d}}%s\n", name, ts, record.arg1, sep);
+			break;
+		case EV_TRACE_CB_END:
+			dump_name(&record, name, sizeof(name));
+			fprintf(stdout, "{\"name\":\"%s\",\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":1}%s\n", name, ts, sep);
+			break;
+		default:
+			FATAL_ERROR("unknown trace record type %d.\n", record.type);
+		}
+	}
+	fprintf(stdout, "]}\n");
+
+	if(fp!=stdin)
+		fclose(fp);
+	return 0;
+}
+
@@ -0,0 +1,320 @@
+#include "gateway.h"
+#include "../ev/port.h"
+
+#define gateway_key_eq(a, b) \
+	(((a).unit==(b).unit) && ((a).function==(b).function) && \
+	 ((a).address==(b).address) && ((a).quantity==(b).quantity))
+
+// 功能码1~4(读线圈/离散输入/保持寄存器/输入寄存器)的请求可合并及缓存.
+static int gateway_parse_key(uint8_t unit, const uint8_t *pdu, int32_t len, gateway_key_t *key)
+{
+	if(unit==0 || len!=5 || pdu[0]<1 || pdu[0]>4)
+		return 0;
+	key->unit = unit;
+	key->function = pdu[0];
+	key->address = (uint16_t)((pdu[1]<<8)|pdu[2]);
+	key->quantity = (uint16_t)((pdu[3]<<8)|pdu[4]);
+	return 1;
+}
+
+// 功能码5/6/15/16/22/23会改变从站的数据.
+#define gateway_is_write(function) \
+	(((function)==5) || ((function)==6) || ((function)==15) || \
+	 ((function)==16) || ((function)==22) || ((function)==23))
+
+static void gateway_respond_exception(gateway_t *gateway, void *client, uint16_t transaction, 
+	uint8_t unit, uint8_t function, uint8_t exception)
+{
+	uint8_t pdu[2];
+	pdu[0] = function|0x80;
+	pdu[1] = exception;
+	gateway->respond(gateway, client, transaction, unit, pdu, sizeof(pdu));
+}
+
+/*************
+ * cache
+ *************/
+static gateway_cache_t *gateway_cache_lookup(gateway_t *gateway, gateway_key_t *key)
+{
+	if(ev_duration_is_zero(gateway->cache_ttl))
+		return NULL;
+
+	ev_duration_t now;
+	get_boot_duration(&now);
+	int32_t i;
+	for(i=0; i<GATEWAY_CACHE_NUM; ++i)
+	{
+		gateway_cache_t *entry = &(gateway->cache[i]);
+		if(!entry->valid || !gateway_key_eq(entry->key, *key))
+			continue;
+		if(ev_duration_lt(entry->expiry, now))
+		{
+			entry->valid = 0;
+			return NULL;
+		}
+		return entry;
+	}
+	return NULL;
+}
+
+// 替换同标识、无效或最早过期的项.
+static void gateway_cache_store(gateway_t *gateway, gateway_key_t *key, const uint8_t *pdu, int32_t len)
+{
+	if(ev_duration_is_zero(gateway->cache_ttl))
+		return;
+
+	gateway_cache_t *victim = NULL;
+	int32_t i;
+	for(i=0; i<GATEWAY_CACHE_NUM; ++i)
+	{
+		gateway_cache_t *entry = &(gateway->cache[i]);
+		if(entry->valid && gateway_key_eq(entry->key, *key)){
+			victim = entry;
+			break;
+		}
+		if(!victim || (victim->valid && (!entry->valid || ev_duration_lt(entry->expiry, victim->expiry))))
+			victim = entry;
+	}
+
+	victim->valid = 1;
+	memcpy(&victim->key, key, sizeof(gateway_key_t));
+	get_boot_duration(&victim->expiry);
+	ev_duration_add(victim->expiry, gateway->cache_ttl);
+	victim->pdu_len = len;
+	memcpy(victim->pdu, pdu, len);
+}
+
+// 写请求使该从站的所有缓存失效.
+static void gateway_cache_invalidate(gateway_t *gateway, uint8_t unit)
+{
+	int32_t i;
+	for(i=0; i<GATEWAY_CACHE_NUM; ++i)
+		if(unit==0 || gateway->cache[i].key.unit==unit)
+			gateway->cache[i].valid = 0;
+}
+
+/*************
+ * txn
+ *************/
+static void on_response_timeout(ev_loop_t *ev_loop, ev_timer_t *timer, int events);
+
+static gateway_txn_t *gateway_txn_alloc(gateway_t *gateway)
+{
+	int32_t i;
+	for(i=0; i<GATEWAY_TXN_NUM; ++i)
+		if(gateway->txns[i].state==GATEWAY_TXN_FREE)
+			return &(gateway->txns[i]);
+	return NULL;
+}
+
+// 查找可合并的排队或在途读请求.
+static gateway_txn_t *gateway_txn_find(gateway_t *gateway, gateway_key_t *key)
+{
+	int32_t i;
+	for(i=0; i<GATEWAY_TXN_NUM; ++i)
+	{
+		gateway_txn_t *txn = &(gateway->txns[i]);
+		if(txn->state!=GATEWAY_TXN_FREE && txn->cacheable && 
+			txn->waiter_cnt<GATEWAY_WAITER_NUM && gateway_key_eq(txn->key, *key))
+			return txn;
+	}
+	return NULL;
+}
+
+// 串口空闲时发送排队中优先级最高、最早的交互.
+static void gateway_kick(gateway_t *gateway)
+{
+	while(!gateway->inflight)
+	{
+		gateway_txn_t *next = NULL;
+		int32_t i;
+		for(i=0; i<GATEWAY_TXN_NUM; ++i)
+		{
+			gateway_txn_t *txn = &(gateway->txns[i]);
+			if(txn->state!=GATEWAY_TXN_QUEUED)
+				continue;
+			if(!next || txn->priority<next->priority || 
+				(txn->priority==next->priority && (int32_t)(txn->seq-next->seq)<0))
+				next = txn;
+		}
+		if(!next)
+			return;
+
+		// 广播请求没有响应,发出即完成.
+		++gateway->rtu_transactions;
+		if(next->unit==0)
+		{
+			next->state = GATEWAY_TXN_FREE;
+			gateway->send_rtu(gateway, next->unit, next->pdu, next->pdu_len);
+			continue;
+		}
+
+		// 先标记在途,send_rtu中即可收到响应.
+		next->state = GATEWAY_TXN_INFLIGHT;
+		gateway->inflight = next;
+		ev_timer_start(gateway->ev_loop, &gateway->timeout_timer, &gateway->response_timeout);
+		gateway->send_rtu(gateway, next->unit, next->pdu, next->pdu_len);
+	}
+}
+
+// 将响应分发给交互上的所有请求者并释放该交互.
+static void gateway_txn_complete(gateway_t *gateway, gateway_txn_t *txn, const uint8_t *pdu, int32_t len)
+{
+	int32_t i;
+	if(txn->cacheable && len>0 && !(pdu[0]&0x80))
+		gateway_cache_store(gateway, &txn->key, pdu, len);
+	else if(gateway_is_write(txn->pdu[0]))
+		gateway_cache_invalidate(gateway, txn->unit);
+
+	// respond中可能提交新的请求并分配到该交互,故先复制再释放.
+	gateway_waiter_t waiters[GATEWAY_WAITER_NUM];
+	int32_t waiter_cnt = txn->waiter_cnt;
+	uint8_t unit = txn->unit;
+	uint8_t function = txn->pdu[0];
+	memcpy(waiters, txn->waiters, sizeof(gateway_waiter_t)*waiter_cnt);
+	txn->waiter_cnt = 0;
+	txn->state = GATEWAY_TXN_FREE;
+
+	for(i=0; i<waiter_cnt; ++i)
+	{
+		if(len>0)
+			gateway->respond(gateway, waiters[i].client, waiters[i].transaction, unit, pdu, len);
+		else
+			gateway_respond_exception(gateway, waiters[i].client, waiters[i].transaction, 
+				unit, function, GATEWAY_EXCEPTION_TARGET_NO_RESPONSE);
+	}
+}
+
+static void on_response_timeout(ev_loop_t *ev_loop, ev_timer_t *timer, int events)
+{
+	gateway_t *gateway = (gateway_t*)(timer->data);
+	gateway_txn_t *txn = gateway->inflight;
+	if(!txn)
+		return;
+
+	++gateway->rtu_timeouts;
+	gateway->inflight = NULL;
+	gateway_txn_complete(gateway, txn, NULL, 0);
+	gateway_kick(gateway);
+}
+
+/*************
+ * gateway
+ *************/
+void gateway_init(gateway_t *gateway, struct ev_loop_t *ev_loop)
+{
+	memset(gateway, 0, sizeof(gateway_t));
+	gateway->ev_loop = ev_loop;
+	gateway->cache_ttl.seconds = 0;
+	gateway->cache_ttl.micro_seconds = 200000;
+	gateway->response_timeout.seconds = 1;
+	gateway->response_timeout.micro_seconds = 0;
+	gateway->read_priority = EV_DEFAULT_PRIORITY;
+	gateway->write_priority = EV_HIGH_PRIORITY;
+
+	// 响应超时不需精确,允许与其他定时器合并.
+	ev_duration_t slack;
+	slack.seconds = 0;
+	slack.micro_seconds = 10000;
+	ev_timer_init(&gateway->timeout_timer, on_response_timeout);
+	ev_timer_set_slack(&gateway->timeout_timer, &slack);
+	sprintf((char*)gateway->timeout_timer.name, "gateway_timeout");
+	gateway->timeout_timer.data = gateway;
+}
+
+int gateway_submit(gateway_t *gateway, void *client, uint16_t transaction, 
+	uint8_t unit, const uint8_t *pdu, int32_t len)
+{
+	if(len<=0 || len>GATEWAY_MAX_PDU)
+		FATAL_ERROR("gateway request pdu length %d exceeds %d.\n", len, GATEWAY_MAX_PDU);
+	++gateway->requests;
+
+	gateway_key_t key;
+	int cacheable = gateway_parse_key(unit, pdu, len, &key);
+	if(cacheable)
+	{
+		gateway_cache_t *entry = gateway_cache_lookup(gateway, &key);
+		if(entry)
+		{
+			++gateway->cache_hits;
+			gateway->respond(gateway, client, transaction, unit, entry->pdu, entry->pdu_len);
+			return 0;
+		}
+
+		gateway_txn_t *txn = gateway_txn_find(gateway, &key);
+		if(txn)
+		{
+			++gateway->merged;
+			txn->waiters[txn->waiter_cnt].client = client;
+			txn->waiters[txn->waiter_cnt].transaction = transaction;
+			++txn->waiter_cnt;
+			return 0;
+		}
+	}else if(gateway_is_write(pdu[0])){
+		// 之后的读请求不应再由旧的缓存响应.
+		gateway_cache_invalidate(gateway, unit);
+	}
+
+	gateway_txn_t *txn = gateway_txn_alloc(gateway);
+	if(!txn)
+	{
+		++gateway->rejected;
+		gateway_respond_exception(gateway, client, transaction, unit, pdu[0], GATEWAY_EXCEPTION_BUSY);
+		return -1;
+	}
+
+	txn->state = GATEWAY_TXN_QUEUED;
+	txn->priority = gateway_is_write(pdu[0])?gateway->write_priority:gateway->read_priority;
+	txn->seq = gateway->seq++;
+	txn->cacheable = cacheable;
+	if(cacheable)
+		memcpy(&txn->key, &key, sizeof(gateway_key_t));
+	txn->unit = unit;
+	txn->pdu_len = len;
+	memcpy(txn->pdu, pdu, len);
+	txn->waiter_cnt = 0;
+	if(unit!=0) // 广播请求不回复
+	{
+		txn->waiters[0].client = client;
+		txn->waiters[0].transaction = transaction;
+		txn->waiter_cnt = 1;
+	}
+
+	gateway_kick(gateway);
+	return 0;
+}
+
+void gateway_rtu_response(gateway_t *gateway, const uint8_t *pdu, int32_t len)
+{
+	gateway_txn_t *txn = gateway->inflight;
+	// 超时后迟到的响应,或与请求功能码不符
+	if(!txn || len<=0 || (pdu[0]&0x7f)!=txn->pdu[0])
+		return;
+
+	ev_timer_stop(gateway->ev_loop, &gateway->timeout_timer);
+	gateway->inflight = NULL;
+	gateway_txn_complete(gateway, txn, pdu, len);
+	gateway_kick(gateway);
+}
+
+void gateway_drop_client(gateway_t *gateway, void *client)
+{
+	int32_t i, j;
+	for(i=0; i<GATEWAY_TXN_NUM; ++i)
+	{
+		gateway_txn_t *txn = &(gateway->txns[i]);
+		if(txn->state==GATEWAY_TXN_FREE)
+			continue;
+		for(j=0; j<txn->waiter_cnt; )
+		{
+			if(txn->waiters[j].client==client)
+				txn->waiters[j] = txn->waiters[--txn->waiter_cnt];
+			else
+				++j;
+		}
+		// 无人等待的排队读请求无需发送;写请求仍需执行.
+		if(txn->state==GATEWAY_TXN_QUEUED && txn->cacheable && !txn->waiter_cnt)
+			txn->state = GATEWAY_TXN_FREE;
+	}
+}
+
@@ -0,0 +1,116 @@
+
+#ifndef _GATEWAY_H_
+#define _GATEWAY_H_
+
+#include <stdint.h>
+#include "../ev/ev.h"
+
+#define GATEWAY_MAX_PDU 253 // Modbus PDU最大长度
+#define GATEWAY_TXN_NUM 32 // 排队及在途的RTU交互数目
+#define GATEWAY_WAITER_NUM 16 // 每个RTU交互上合并的TCP请求数目
+#define GATEWAY_CACHE_NUM 64 // 缓存的读响应数目
+
+// RTU从站无响应时返回的异常码
+#define GATEWAY_EXCEPTION_TARGET_NO_RESPONSE 0x0B
+// 排队已满时返回的异常码
+#define GATEWAY_EXCEPTION_BUSY 0x06
+
+/*
+ * gateway_key : 读请求的标识,相同标识的读请求可合并及缓存.
+ */
+typedef struct gateway_key_t{
+	uint8_t unit;
+	uint8_t function;
+	uint16_t address;
+	uint16_t quantity;
+}gateway_key_t;
+
+// 等待响应的TCP请求
+typedef struct gateway_waiter_t{
+	void *client; // 请求所属的TCP会话(由使用者定义)
+	uint16_t transaction; // MBAP事务号
+}gateway_waiter_t;
+
+#define GATEWAY_TXN_FREE 0
+#define GATEWAY_TXN_QUEUED 1
+#define GATEWAY_TXN_INFLIGHT 2
+
+/*
+ * gateway_txn : 一次RTU交互.
+ *
+ * priority : EV_HIGH_PRIORITY..EV_LOW_PRIORITY,排队时优先级高者先发送,同优先级按seq先后;
+ * cacheable : 是否为可合并/缓存的读请求(功能码1~4).
+ */
+typedef struct gateway_txn_t{
+	int32_t state;
+	int32_t priority;
+	uint32_t seq;
+	int32_t cacheable;
+	gateway_key_t key;
+	uint8_t unit;
+	int32_t pdu_len;
+	uint8_t pdu[GATEWAY_MAX_PDU];
+	int32_t waiter_cnt;
+	gateway_waiter_t waiters[GATEWAY_WAITER_NUM];
+}gateway_txn_t;
+
+typedef struct gateway_cache_t{
+	int32_t valid;
+	gateway_key_t key;
+	ev_duration_t expiry;
+	int32_t pdu_len;
+	uint8_t pdu[GATEWAY_MAX_PDU];
+}gateway_cache_t;
+
+/*
+ * gateway : 网关调度.
+ *
+ * cache_ttl : 读响应的缓存时长,为0时不缓存;
+ * response_timeout : RTU响应超时;
+ * read/write_priority : 读/写请求(功能码5/6/15/16/22/23)的排队优先级;
+ * send_rtu : 向串口发送一个RTU请求(由使用者编码并写出);
+ * respond : 向TCP请求者回复响应PDU.
+ */
+typedef struct gateway_t{
+	struct ev_loop_t *ev_loop;
+	ev_duration_t cache_ttl;
+	ev_duration_t response_timeout;
+	int32_t read_priority;
+	int32_t write_priority;
+	void (*send_rtu)(struct gateway_t *gateway, uint8_t unit, const uint8_t *pdu, int32_t len);
+	void (*respond)(struct gateway_t *gateway, void *client, uint16_t transaction, 
+		uint8_t unit, const uint8_t *pdu, int32_t len);
+	void *data;
+
+	gateway_txn_t txns[GATEWAY_TXN_NUM];
+	gateway_txn_t *inflight;
+	uint32_t seq;
+	gateway_cache_t cache[GATEWAY_CACHE_NUM];
+	ev_timer_t timeout_timer;
+
+	// 统计
+	int32_t requests; // TCP请求数
+	int32_t cache_hits; // 由缓存响应的请求数
+	int32_t merged; // 合并到已有RTU交互的请求数
+	int32_t rtu_transactions; // 发送的RTU交互数
+	int32_t rtu_timeouts; // RTU响应超时数
+	int32_t rejected; // 排队已满而拒绝的请求数
+}gateway_t;
+
+void gateway_init(gateway_t *gateway, struct ev_loop_t *ev_loop);
+
+/*
+ * 提交一个TCP请求,响应(可能在本次调用中)经respond回复.
+ * 排队已满时回复异常并返回-1,否则返回0.
+ */
+int gateway_submit(gateway_t *gateway, void *client, uint16_t transaction, 
+	uint8_t unit, const uint8_t *pdu, int32_t len);
+
+// 串口收到RTU响应(已解码为PDU).
+void gateway_rtu_response(gateway_t *gateway, const uint8_t *pdu, int32_t len);
+
+// TCP会话断开,丢弃其尚未回复的请求.
+void gateway_drop_client(gateway_t *gateway, void *client);
+
+#endif
+
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include "gateway.h"
+
+#if defined(GATEWAY_MERGE_TEST) || defined(GATEWAY_RESUBMIT_TEST)
+/*
+ * 模拟串口:每个RTU交互耗时5ms,响应为请求的数量个寄存器值(读)或请求本身(写).
+ */
+static ev_timer_t serial_timer;
+static uint8_t serial_request[GATEWAY_MAX_PDU];
+static int32_t serial_request_len = 0;
+static int32_t responses = 0;
+static void (*on_respond)(gateway_t *gateway, void *client, const uint8_t *pdu, int32_t len) = NULL;
+
+static void on_serial_done(ev_loop_t *ev_loop, ev_timer_t *timer, int events)
+{
+	gateway_t *gateway = (gateway_t*)timer->data;
+	uint8_t pdu[GATEWAY_MAX_PDU];
+	int32_t len = serial_request_len;
+	memcpy(pdu, serial_request, len);
+	if(serial_request[0]==3)
+	{
+		int32_t quantity = (serial_request[3]<<8)|serial_request[4], i;
+		pdu[1] = (uint8_t)(quantity*2);
+		for(i=0; i<quantity*2; ++i)
+			pdu[2+i] = (uint8_t)i;
+		len = 2+quantity*2;
+	}
+	gateway_rtu_response(gateway, pdu, len);
+}
+
+static void send_rtu(gateway_t *gateway, uint8_t unit, const uint8_t *pdu, int32_t len)
+{
+	memcpy(serial_request, pdu, len);
+	serial_request_len = len;
+	ev_duration_t d;
+	d.seconds = 0; d.micro_seconds = 5000;
+	ev_timer_start(gateway->ev_loop, &serial_timer, &d);
+}
+
+static void respond(gateway_t *gateway, void *client, uint16_t transaction, 
+	uint8_t unit, const uint8_t *pdu, int32_t len)
+{
+	++responses;
+	if(on_respond)
+		on_respond(gateway, client, pdu, len);
+}
+
+static void setup_gateway(ev_loop_t *ev_loop, gateway_t *gateway)
+{
+	ev_loop_init(ev_loop);
+	gateway_init(gateway, ev_loop);
+	gateway->send_rtu = send_rtu;
+	gateway->respond = respond;
+	ev_timer_init(&serial_timer, on_serial_done);
+	serial_timer.data = gateway;
+}
+
+static void run_for(ev_loop_t *ev_loop, int32_t micro_seconds)
+{
+	ev_timer_t timer;
+	ev_duration_t d;
+	d.seconds = 0; d.micro_seconds = micro_seconds;
+	ev_timer_init(&timer, NULL);
+	ev_timer_start(ev_loop, &timer, &d);
+	while(ev_is_active(&timer))
+		ev_loop_run(ev_loop);
+}
+#endif
+
+#ifdef GATEWAY_MERGE_TEST
+#define CLIENT_NUM 8
+#define ROUND_NUM 20
+
+static void test_gateway_merge()
+{
+	static ev_loop_t ev_loop;
+	static gateway_t gateway;
+	setup_gateway(&ev_loop, &gateway);
+
+	// 每轮每个客户端读取相同的两段保持寄存器,第10轮时一个客户端写入.
+	uint8_t read_a[5] = {3, 0x00, 0x00, 0x00, 0x10};
+	uint8_t read_b[5] = {3, 0x00, 0x40, 0x00, 0x08};
+	uint8_t write[5] = {6, 0x00, 0x01, 0x12, 0x34};
+	int32_t requests = 0, round, client;
+	for(round=0; round<ROUND_NUM; ++round)
+	{
+		for(client=0; client<CLIENT_NUM; ++client)
+		{
+			gateway_submit(&gateway, (void*)(intptr_t)(client+1), round, 1, read_a, sizeof(read_a));
+			gateway_submit(&gateway, (void*)(intptr_t)(client+1), round, 1, read_b, sizeof(read_b));
+			requests += 2;
+		}
+		if(round==10)
+		{
+			gateway_submit(&gateway, (void*)1, round, 1, write, sizeof(write));
+			++requests;
+		}
+
+		// 每轮间隔50ms
+		run_for(&ev_loop, 50000);
+	}
+
+	fprintf(stdout, "%d requests, %d responses, %d cache hits, %d merged, %d rtu transactions, %d timeouts\n", 
+		requests, responses, gateway.cache_hits, gateway.merged, gateway.rtu_transactions, gateway.rtu_timeouts
+	);
+}
+#endif
+
+#ifdef GATEWAY_RESUBMIT_TEST
+/*
+ * 合并的读请求完成时,第一个请求者在respond中立即提交写请求,
+ * 该写请求可能分配到刚释放的交互,其余请求者及写请求都应得到响应.
+ */
+static int32_t client_responses[5];
+static uint8_t write_pdu[5] = {6, 0x00, 0x01, 0x12, 0x34};
+
+static void resubmit_on_respond(gateway_t *gateway, void *client, const uint8_t *pdu, int32_t len)
+{
+	intptr_t id = (intptr_t)client;
+	++client_responses[id];
+	if(id==1 && pdu[0]==3)
+		gateway_submit(gateway, client, 100, 1, write_pdu, sizeof(write_pdu));
+}
+
+static void test_gateway_resubmit()
+{
+	static ev_loop_t ev_loop;
+	static gateway_t gateway;
+	setup_gateway(&ev_loop, &gateway);
+	on_respond = resubmit_on_respond;
+
+	uint8_t read_pdu[5] = {3, 0x00, 0x00, 0x00, 0x04};
+	intptr_t client;
+	for(client=1; client<=4; ++client)
+		gateway_submit(&gateway, (void*)client, (uint16_t)client, 1, read_pdu, sizeof(read_pdu));
+	run_for(&ev_loop, 50000);
+
+	int32_t ok = (client_responses[1]==2);
+	for(client=2; client<=4; ++client)
+		ok = ok && (client_responses[client]==1);
+	fprintf(stdout, "client responses %d %d %d %d, %d rtu transactions : %s\n", 
+		client_responses[1], client_responses[2], client_responses[3], client_responses[4], 
+		gateway.rtu_transactions, ok?"ok":"FAILED"
+	);
+}
+#endif
+
+int main()
+{
+#ifdef GATEWAY_MERGE_TEST
+	test_gateway_merge();
+#endif
+#ifdef GATEWAY_RESUBMIT_TEST
+	test_gateway_resubmit();
+#endif
+	return 0;
+}
+
@@ -0,0 +1,34 @@
+#include "mbap.h"
+
+int32_t mbap_decode(const uint8_t *buf, int32_t len, mbap_header_t *header)
+{
+	if(len<MBAP_HEADER_LEN)
+		return 0;
+
+	header->transaction = (uint16_t)((buf[0]<<8)|buf[1]);
+	header->protocol = (uint16_t)((buf[2]<<8)|buf[3]);
+	header->length = (uint16_t)((buf[4]<<8)|buf[5]);
+	header->unit = buf[6];
+	if(header->protocol!=0 || header->length<2 || header->length>MBAP_MAX_PDU_LEN+1)
+		return -1;
+
+	int32_t frame_len = MBAP_HEADER_LEN-1+header->length;
+	return (len<frame_len)?0:frame_len;
+}
+
+int32_t mbap_encode(uint16_t transaction, uint8_t unit, const uint8_t *pdu, int32_t pdu_len, uint8_t *out)
+{
+	if(pdu_len<=0 || pdu_len>MBAP_MAX_PDU_LEN)
+		FATAL_ERROR("mbap pdu length %d exceeds %d.\n", pdu_len, MBAP_MAX_PDU_LEN);
+
+	out[0] = (uint8_t)(transaction>>8);
+	out[1] = (uint8_t)(transaction);
+	out[2] = 0;
+	out[3] = 0;
+	out[4] = (uint8_t)((pdu_len+1)>>8);
+	out[5] = (uint8_t)(pdu_len+1);
+	out[6] = unit;
+	memcpy(&out[MBAP_HEADER_LEN], pdu, pdu_len);
+	return MBAP_HEADER_LEN+pdu_len;
+}
+
@@ -0,0 +1,37 @@
+
+#ifndef _MBAP_H_
+#define _MBAP_H_
+
+#include <stdint.h>
+#include "../../platform.h"
+
+/*
+ * Modbus TCP的MBAP报文头编解码.
+ *
+ * 帧 : 事务号(2) + 协议号(2,恒为0) + 长度(2,单元号与PDU的字节数) + 单元号(1) + PDU.
+ */
+#define MBAP_HEADER_LEN 7
+#define MBAP_MAX_PDU_LEN 253
+#define MBAP_MAX_FRAME_LEN (MBAP_HEADER_LEN+MBAP_MAX_PDU_LEN)
+
+typedef struct mbap_header_t{
+	uint16_t transaction;
+	uint16_t protocol;
+	uint16_t length;
+	uint8_t unit;
+}mbap_header_t;
+
+/*
+ * 从buf中解码一帧的报文头.
+ * 返回完整帧的字节数,数据不足一帧时返回0,报文头非法时返回-1.
+ * PDU位于buf+MBAP_HEADER_LEN,长度为header->length-1.
+ */
+int32_t mbap_decode(const uint8_t *buf, int32_t len, mbap_header_t *header);
+
+/*
+ * 将报文头及PDU编码到out(至少MBAP_MAX_FRAME_LEN字节),返回帧的字节数.
+ */
+int32_t mbap_encode(uint16_t transaction, uint8_t unit, const uint8_t *pdu, int32_t pdu_len, uint8_t *out);
+
+#endif
+
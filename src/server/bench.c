@@ -0,0 +1,215 @@
+/*
+ * 多监听服务端的连接数/时延测试:
+ * 启动若干线程,各自以SO_REUSEPORT在同一端口上运行一个服务端实例,
+ * 由本机的大量客户端socket建立连接并轮流发送读保持寄存器请求.
+ *
+ * 用法 : bench [线程数] [客户端数] [每客户端请求数] [busy poll时长(us),0为不自旋]
+ */
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "modbus_tcp_server.h"
+
+#define BENCH_PORT 15020
+#define BENCH_MAX_LOOPS 16
+#define BENCH_MAX_CLIENTS (BENCH_MAX_LOOPS*MODBUS_TCP_SESSION_NUM)
+
+typedef struct bench_loop_t{
+	pthread_t thread;
+	ev_loop_t ev_loop;
+	modbus_tcp_server_t server;
+	ev_timer_t stop_timer;
+	int32_t ready;
+}bench_loop_t;
+
+static bench_loop_t bench_loops[BENCH_MAX_LOOPS];
+static volatile int bench_running = 1;
+static int32_t bench_busy_poll_us = 0;
+
+// 读保持寄存器返回全0,其他功能码返回非法功能码异常.
+static int32_t bench_handler(modbus_tcp_server_t *server, uint8_t unit, 
+	const uint8_t *req, int32_t req_len, uint8_t *rsp)
+{
+	if(req_len==5 && req[0]==3)
+	{
+		int32_t quantity = (req[3]<<8)|req[4];
+		if(quantity<1 || quantity>125)
+			quantity = 1;
+		rsp[0] = 3;
+		rsp[1] = (uint8_t)(quantity*2);
+		memset(&rsp[2], 0, quantity*2);
+		return 2+quantity*2;
+	}
+	rsp[0] = req[0]|0x80;
+	rsp[1] = 0x01;
+	return 2;
+}
+
+// 事件循环无其他定时事件时会一直阻塞,以定时器检查是否结束.
+static void on_stop_check(ev_loop_t *ev_loop, ev_timer_t *timer, int events)
+{
+	if(!bench_running)
+		return;
+	ev_duration_t d;
+	d.seconds = 0; d.micro_seconds = 100000;
+	ev_timer_start(ev_loop, timer, &d);
+}
+
+static void *bench_loop_run(void *arg)
+{
+	bench_loop_t *loop = (bench_loop_t*)arg;
+	ev_loop_init(&loop->ev_loop);
+	if(modbus_tcp_server_open(&loop->server, &loop->ev_loop, "127.0.0.1", BENCH_PORT))
+		FATAL_ERROR("failed to open modbus tcp server, errno %d\n", errno);
+	loop->server.handler = bench_handler;
+	if(bench_busy_poll_us>0)
+	{
+		ev_duration_t budget;
+		budget.seconds = bench_busy_poll_us/MICRO_SECONDS_ONE_SECOND;
+		budget.micro_seconds = bench_busy_poll_us%MICRO_SECONDS_ONE_SECOND;
+		ev_loop_set_busy_poll(&loop->ev_loop, &budget);
+		loop->server.busy_poll_us = bench_busy_poll_us;
+	}
+
+	ev_timer_init(&loop->stop_timer, on_stop_check);
+	on_stop_check(&loop->ev_loop, &loop->stop_timer, EV_TIMEOUT);
+	__atomic_store_n(&loop->ready, 1, __ATOMIC_RELEASE);
+
+	while(bench_running)
+		ev_loop_run(&loop->ev_loop);
+	modbus_tcp_server_close(&loop->server);
+	return NULL;
+}
+
+static int64_t bench_now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec*1000000000L + ts.tv_nsec;
+}
+
+static int bench_cmp_int64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+	return (x<y)?-1:(x>y)?1:0;
+}
+
+int main(int argc, char *argv[])
+{
+	int32_t loop_num = (argc>1)?atoi(argv[1]):4;
+	int32_t client_num = (argc>2)?atoi(argv[2]):100;
+	int32_t request_num = (argc>3)?atoi(argv[3]):100;
+	bench_busy_poll_us = (argc>4)?atoi(argv[4]):0;
+	if(loop_num<=0 || loop_num>BENCH_MAX_LOOPS || client_num<=0 || 
+		client_num>loop_num*MODBUS_TCP_SESSION_NUM || request_num<=0)
+		FATAL_ERROR("usage : %s [loops(1-%d)] [clients(<=loops*%d)] [requests per client] [busy poll us]\n", 
+			argv[0], BENCH_MAX_LOOPS, MODBUS_TCP_SESSION_NUM);
+
+	int32_t i, j;
+	for(i=0; i<loop_num; ++i)
+	{
+		pthread_create(&bench_loops[i].thread, NULL, bench_loop_run, &bench_loops[i]);
+		while(!__atomic_load_n(&bench_loops[i].ready, __ATOMIC_ACQUIRE))
+			usleep(1000);
+	}
+
+	// 建立连接
+	// 内核按哈希在各监听socket间分配连接,某个实例会话已满时连接被关闭.
+	static int clients[BENCH_MAX_CLIENTS];
+	static int32_t closed[BENCH_MAX_CLIENTS];
+	int32_t closed_cnt = 0;
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(BENCH_PORT);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	int64_t connect_begin = bench_now_ns();
+	for(i=0; i<client_num; ++i)
+	{
+		clients[i] = socket(AF_INET, SOCK_STREAM, 0);
+		if(clients[i]<0 || connect(clients[i], (struct sockaddr*)&sin, sizeof(sin)))
+			FATAL_ERROR("client %d failed to connect, errno %d\n", i, errno);
+		int one = 1;
+		setsockopt(clients[i], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+	int64_t connect_ns = bench_now_ns()-connect_begin;
+
+	// 各客户端轮流发送请求并等待响应
+	static int64_t latencies[1<<20];
+	int32_t latency_cnt = 0;
+	uint8_t req[MBAP_MAX_FRAME_LEN], rsp[MBAP_MAX_FRAME_LEN];
+	uint8_t pdu[5] = {3, 0x00, 0x00, 0x00, 0x0a};
+	int64_t requests_begin = bench_now_ns();
+	for(j=0; j<request_num; ++j)
+	{
+		for(i=0; i<client_num; ++i)
+		{
+			if(closed[i])
+				continue;
+			int32_t req_len = mbap_encode((uint16_t)j, 1, pdu, sizeof(pdu), req);
+			int64_t begin = bench_now_ns();
+			if(send(clients[i], req, req_len, MSG_NOSIGNAL)!=req_len)
+			{
+				closed[i] = 1;
+				++closed_cnt;
+				continue;
+			}
+			int32_t rsp_len = 0, frame_len = 0;
+			mbap_header_t header;
+			while(frame_len<=0)
+			{
+				ssize_t n = recv(clients[i], &rsp[rsp_len], sizeof(rsp)-rsp_len, 0);
+				if(n<=0)
+					break;
+				rsp_len += n;
+				frame_len = mbap_decode(rsp, rsp_len, &header);
+				if(frame_len<0)
+					FATAL_ERROR("client %d received invalid frame.\n", i);
+			}
+			if(frame_len<=0)
+			{
+				closed[i] = 1;
+				++closed_cnt;
+				continue;
+			}
+			if(latency_cnt<(int32_t)(sizeof(latencies)/sizeof(latencies[0])))
+				latencies[latency_cnt++] = bench_now_ns()-begin;
+		}
+	}
+	int64_t requests_ns = bench_now_ns()-requests_begin;
+
+	bench_running = 0;
+	for(i=0; i<client_num; ++i)
+		close(clients[i]);
+	for(i=0; i<loop_num; ++i)
+		pthread_join(bench_loops[i].thread, NULL);
+
+	qsort(latencies, latency_cnt, sizeof(int64_t), bench_cmp_int64);
+	int64_t latency_sum = 0;
+	for(i=0; i<latency_cnt; ++i)
+		latency_sum += latencies[i];
+
+	fprintf(stdout, "%d loops, %d clients : connected in %.3f ms (%.0f conn/s)\n", 
+		loop_num, client_num, connect_ns/1e6, client_num/(connect_ns/1e9));
+	for(i=0; i<loop_num; ++i)
+		fprintf(stdout, "  loop %d : accepted %d in %d wakeups, rejected %d, requests %d, "
+			"busy poll hits %lld timeouts %lld blocks %lld\n", i, 
+			bench_loops[i].server.accepted, bench_loops[i].server.accept_wakeups, 
+			bench_loops[i].server.rejected, bench_loops[i].server.requests, 
+			(long long)bench_loops[i].ev_loop.busy_poll_hits, 
+			(long long)bench_loops[i].ev_loop.busy_poll_timeouts, 
+			(long long)bench_loops[i].ev_loop.busy_poll_blocks);
+	fprintf(stdout, "%d clients closed by server\n", closed_cnt);
+	if(!latency_cnt)
+		return 0;
+	fprintf(stdout, "%d requests : %.0f req/s, latency avg %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n", 
+		latency_cnt, latency_cnt/(requests_ns/1e9), latency_sum/1e3/latency_cnt, 
+		latencies[latency_cnt/2]/1e3, latencies[latency_cnt*99/100]/1e3, latencies[latency_cnt-1]/1e3);
+	return 0;
+}
+
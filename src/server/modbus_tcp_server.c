@@ -0,0 +1,237 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // accept4
+#endif
+
+#include "modbus_tcp_server.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/*************
+ * session
+ *************/
+static void modbus_tcp_session_close(modbus_tcp_session_t *session)
+{
+	modbus_tcp_server_t *server = session->server;
+	ev_io_stop(server->ev_loop, &session->io);
+	close(session->io.fd);
+	session->used = 0;
+	--server->session_cnt;
+}
+
+// 写出缓存的响应,返回0为已写完,1为仍有剩余,-1为连接出错.
+static int modbus_tcp_session_flush(modbus_tcp_session_t *session)
+{
+	while(session->tx_off<session->tx_len)
+	{
+		ssize_t n = send(session->io.fd, &session->tx[session->tx_off], 
+			session->tx_len-session->tx_off, MSG_NOSIGNAL);
+		if(n<0)
+		{
+			if(errno==EINTR)
+				continue;
+			if(errno==EAGAIN || errno==EWOULDBLOCK)
+				return 1;
+			return -1;
+		}
+		session->tx_off += n;
+	}
+	session->tx_len = 0;
+	session->tx_off = 0;
+	return 0;
+}
+
+// 处理rx中的完整请求,返回-1时应关闭连接.
+static int modbus_tcp_session_process(modbus_tcp_session_t *session)
+{
+	modbus_tcp_server_t *server = session->server;
+	int32_t offset = 0;
+	while(session->tx_len==0)
+	{
+		mbap_header_t header;
+		int32_t frame_len = mbap_decode(&session->rx[offset], session->rx_len-offset, &header);
+		if(frame_len<0)
+			return -1;
+		if(frame_len==0)
+			break;
+
+		uint8_t rsp[MBAP_MAX_PDU_LEN];
+		int32_t rsp_len = server->handler(server, header.unit, 
+			&session->rx[offset+MBAP_HEADER_LEN], header.length-1, rsp);
+		++server->requests;
+		offset += frame_len;
+		if(rsp_len>0)
+		{
+			session->tx_len = mbap_encode(header.transaction, header.unit, rsp, rsp_len, session->tx);
+			if(modbus_tcp_session_flush(session)<0)
+				return -1;
+		}
+	}
+
+	if(offset>0)
+	{
+		memmove(session->rx, &session->rx[offset], session->rx_len-offset);
+		session->rx_len -= offset;
+	}
+
+	// 有未写完的响应时关注可写,之后再处理剩余请求.
+	ev_io_modify(server->ev_loop, &session->io, session->tx_len?EV_WRITABLE:EV_READABLE);
+	return 0;
+}
+
+static void on_session_event(ev_loop_t *ev_loop, ev_io_t *ev_io, int events)
+{
+	modbus_tcp_session_t *session = (modbus_tcp_session_t*)(ev_io->data);
+
+	if(events & EV_WRITABLE)
+	{
+		int ret = modbus_tcp_session_flush(session);
+		if(ret<0)
+		{
+			modbus_tcp_session_close(session);
+			return;
+		}
+		if(ret>0)
+			return;
+	}
+
+	if(events & EV_READABLE)
+	{
+		ssize_t n = recv(ev_io->fd, &session->rx[session->rx_len], 
+			sizeof(session->rx)-session->rx_len, 0);
+		if(n==0 || (n<0 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR))
+		{
+			modbus_tcp_session_close(session);
+			return;
+		}
+		if(n>0)
+			session->rx_len += n;
+	}
+
+	if(modbus_tcp_session_process(session)<0)
+		modbus_tcp_session_close(session);
+}
+
+/*************
+ * server
+ *************/
+static modbus_tcp_session_t *modbus_tcp_session_alloc(modbus_tcp_server_t *server)
+{
+	int32_t i;
+	for(i=0; i<MODBUS_TCP_SESSION_NUM; ++i)
+		if(!server->sessions[i].used)
+			return &(server->sessions[i]);
+	return NULL;
+}
+
+// 批量accept,直到EAGAIN或达到MODBUS_TCP_ACCEPT_BATCH.
+static void on_accept(ev_loop_t *ev_loop, ev_io_t *ev_io, int events)
+{
+	modbus_tcp_server_t *server = (modbus_tcp_server_t*)(ev_io->data);
+	int32_t i;
+	++server->accept_wakeups;
+	for(i=0; i<MODBUS_TCP_ACCEPT_BATCH; ++i)
+	{
+		int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK|SOCK_CLOEXEC);
+		if(fd<0)
+		{
+			if(errno==EINTR || errno==ECONNABORTED)
+				continue;
+			break; // EAGAIN或资源不足,等待下次可读
+		}
+
+		// 事件循环上的其他ev_io(串口、协程等)同样占用anfds,已满时ev_io_start会FATAL_ERROR;
+		// 超出backend可关注范围的fd(如select的FD_SETSIZE)同样不能启动ev_io.
+		modbus_tcp_session_t *session = NULL;
+		if(ev_loop->anfd_cnt<MAX_FD_NUMS && fd<=ev_loop->backend_max_fd)
+			session = modbus_tcp_session_alloc(server);
+		if(!session)
+		{
+			++server->rejected;
+			close(fd);
+			continue;
+		}
+
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_BUSY_POLL
+		if(server->busy_poll_us>0)
+			setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &server->busy_poll_us, sizeof(server->busy_poll_us));
+#endif
+
+		session->used = 1;
+		session->server = server;
+		session->rx_len = 0;
+		session->tx_len = 0;
+		session->tx_off = 0;
+		ev_io_init(&session->io, on_session_event, fd, EV_READABLE);
+		snprintf((char*)session->io.name, sizeof(session->io.name), "modbus_tcp_session%d", fd);
+		session->io.data = session;
+		ev_io_start(ev_loop, &session->io);
+		++server->session_cnt;
+		++server->accepted;
+	}
+}
+
+int modbus_tcp_server_open(modbus_tcp_server_t *server, struct ev_loop_t *ev_loop, 
+	const char *addr, uint16_t port)
+{
+	memset(server, 0, sizeof(modbus_tcp_server_t));
+	server->ev_loop = ev_loop;
+
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = htonl(INADDR_ANY);
+	if(addr && inet_pton(AF_INET, addr, &sin.sin_addr)!=1)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	int fd = socket(AF_INET, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+	if(fd<0)
+		return -1;
+	int one = 1;
+	if(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) || 
+		setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) || 
+		bind(fd, (struct sockaddr*)&sin, sizeof(sin)) || 
+		listen(fd, SOMAXCONN))
+	{
+		int err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+	if(fd>ev_loop->backend_max_fd)
+	{
+		close(fd);
+		errno = EMFILE;
+		return -1;
+	}
+
+	server->listen_fd = fd;
+	ev_io_init(&server->listen_io, on_accept, fd, EV_READABLE);
+	snprintf((char*)server->listen_io.name, sizeof(server->listen_io.name), "modbus_tcp_listen");
+	server->listen_io.data = server;
+	ev_io_start(ev_loop, &server->listen_io);
+	return 0;
+}
+
+void modbus_tcp_server_close(modbus_tcp_server_t *server)
+{
+	int32_t i;
+	for(i=0; i<MODBUS_TCP_SESSION_NUM; ++i)
+		if(server->sessions[i].used)
+			modbus_tcp_session_close(&server->sessions[i]);
+	ev_io_stop(server->ev_loop, &server->listen_io);
+	close(server->listen_fd);
+	server->listen_fd = -1;
+}
+
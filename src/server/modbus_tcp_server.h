@@ -0,0 +1,66 @@
+
+#ifndef _MODBUS_TCP_SERVER_H_
+#define _MODBUS_TCP_SERVER_H_
+
+#include "../ev/ev.h"
+#include "../protocol/modbus/mbap.h"
+
+#define MODBUS_TCP_SESSION_NUM (MAX_FD_NUMS-1) // 会话数上限,实际还受事件循环上其他ev_io占用的anfds限制
+#define MODBUS_TCP_ACCEPT_BATCH 16 // 每次可读事件中至多accept的连接数
+
+struct modbus_tcp_server_t;
+
+/*
+ * modbus_tcp_session : 一个TCP连接.
+ *
+ * rx/rx_len : 尚未处理完的接收数据;
+ * tx/tx_len/tx_off : 尚未写出的响应,写完之前不处理后续请求.
+ */
+typedef struct modbus_tcp_session_t{
+	ev_io_t io;
+	int32_t used;
+	struct modbus_tcp_server_t *server;
+	uint8_t rx[MBAP_MAX_FRAME_LEN];
+	int32_t rx_len;
+	uint8_t tx[MBAP_MAX_FRAME_LEN];
+	int32_t tx_len;
+	int32_t tx_off;
+}modbus_tcp_session_t;
+
+/*
+ * modbus_tcp_server : 一个事件循环上的服务端实例.
+ *
+ * handler : 处理请求PDU,将响应PDU写入rsp(至少MBAP_MAX_PDU_LEN字节),
+ *           返回响应的长度,返回0时不响应;
+ * busy_poll_us : >0时对会话socket设置SO_BUSY_POLL(与事件循环的busy poll模式配合);
+ * data : 自定义数据.
+ */
+typedef struct modbus_tcp_server_t{
+	struct ev_loop_t *ev_loop;
+	fd_type_t listen_fd;
+	ev_io_t listen_io;
+	modbus_tcp_session_t sessions[MODBUS_TCP_SESSION_NUM];
+	int32_t session_cnt;
+	int32_t (*handler)(struct modbus_tcp_server_t *server, uint8_t unit, 
+		const uint8_t *req, int32_t req_len, uint8_t *rsp);
+	int32_t busy_poll_us;
+	void *data;
+
+	// 统计
+	int32_t accepted; // 接受的连接数
+	int32_t accept_wakeups; // 处理accept的可读事件数
+	int32_t rejected; // 因会话或事件循环的anfds已满,或fd超出backend可关注范围而关闭的连接数
+	int32_t requests; // 处理的请求数
+}modbus_tcp_server_t;
+
+/*
+ * 在ev_loop上以SO_REUSEPORT监听addr(NULL为任意地址):port.
+ * 多个线程各自在自己的事件循环上打开同一端口即可分担连接.
+ * 成功返回0,失败返回-1(errno保留).
+ */
+int modbus_tcp_server_open(modbus_tcp_server_t *server, struct ev_loop_t *ev_loop, 
+	const char *addr, uint16_t port);
+void modbus_tcp_server_close(modbus_tcp_server_t *server);
+
+#endif
+
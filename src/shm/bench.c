@@ -0,0 +1,119 @@
+/*
+ * 共享内存映像的吞吐测试:一个写者线程不断提交,多个读者线程读取变化的块并校验一致性.
+ * 写者每次将一块的全部寄存器写为同一值,读者读到不一致的快照即为错误.
+ *
+ * 用法 : bench [读者数目] [持续秒数]
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "reader.h"
+
+#define BENCH_SHM_NAME "/softplc_image_bench"
+
+static volatile int bench_running = 1;
+static int64_t bench_commits = 0;
+
+typedef struct bench_reader_stat_t{
+	int64_t scans; // 变化检测的扫描次数
+	int64_t blocks; // 读取的块数
+	int64_t torn; // 不一致的快照数
+}bench_reader_stat_t;
+
+static void *bench_writer(void *arg)
+{
+	shm_image_t *image = (shm_image_t*)arg;
+	uint16_t values[SHM_IMAGE_BLOCK_REGS];
+	uint16_t v = 0;
+	while(bench_running)
+	{
+		int32_t block = rand()%SHM_IMAGE_BLOCK_NUM, i;
+		++v;
+		for(i=0; i<SHM_IMAGE_BLOCK_REGS; ++i)
+			values[i] = v;
+		bench_commits += shm_image_write(image, block*SHM_IMAGE_BLOCK_REGS, values, SHM_IMAGE_BLOCK_REGS);
+	}
+	return NULL;
+}
+
+static void *bench_reader(void *arg)
+{
+	bench_reader_stat_t *stat = (bench_reader_stat_t*)arg;
+	static __thread shm_reader_t reader;
+	if(shm_reader_open(&reader, BENCH_SHM_NAME))
+		FATAL_ERROR("reader failed to open %s\n", BENCH_SHM_NAME);
+
+	uint16_t regs[SHM_IMAGE_BLOCK_REGS];
+	uint32_t changed[SHM_IMAGE_BITMAP_WORDS];
+	while(bench_running)
+	{
+		++stat->scans;
+		if(!shm_reader_changed(&reader))
+		{
+			sched_yield();
+			continue;
+		}
+		int32_t block = -1;
+		while((block=shm_reader_next_changed(&reader, block+1))>=0)
+		{
+			shm_reader_read_block(&reader, block, regs, changed);
+			++stat->blocks;
+			int32_t i;
+			for(i=1; i<SHM_IMAGE_BLOCK_REGS; ++i)
+			{
+				if(regs[i]!=regs[0])
+				{
+					++stat->torn;
+					break;
+				}
+			}
+		}
+	}
+	shm_reader_close(&reader);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int32_t reader_num = (argc>1)?atoi(argv[1]):4;
+	int32_t seconds = (argc>2)?atoi(argv[2]):3;
+	if(reader_num<=0 || reader_num>64 || seconds<=0)
+		FATAL_ERROR("usage : %s [readers(1-64)] [seconds]\n", argv[0]);
+
+	shm_image_t image;
+	if(shm_image_create(&image, BENCH_SHM_NAME))
+		FATAL_ERROR("failed to create %s\n", BENCH_SHM_NAME);
+
+	pthread_t writer, readers[64];
+	bench_reader_stat_t stats[64];
+	memset(stats, 0, sizeof(stats));
+	int32_t i;
+	for(i=0; i<reader_num; ++i)
+		pthread_create(&readers[i], NULL, bench_reader, &stats[i]);
+	pthread_create(&writer, NULL, bench_writer, &image);
+
+	sleep(seconds);
+	bench_running = 0;
+
+	pthread_join(writer, NULL);
+	bench_reader_stat_t total;
+	memset(&total, 0, sizeof(total));
+	for(i=0; i<reader_num; ++i)
+	{
+		pthread_join(readers[i], NULL);
+		total.scans += stats[i].scans;
+		total.blocks += stats[i].blocks;
+		total.torn += stats[i].torn;
+	}
+
+	fprintf(stdout, "writer : %.0f commits/s\n", (double)bench_commits/seconds);
+	fprintf(stdout, "%d readers : %.0f scans/s, %.0f blocks/s (%.1f MB/s), %lld torn snapshots\n", 
+		reader_num, (double)total.scans/seconds, (double)total.blocks/seconds, 
+		(double)total.blocks*sizeof(uint16_t)*SHM_IMAGE_BLOCK_REGS/seconds/1e6, 
+		(long long)total.torn
+	);
+
+	shm_image_destroy(&image);
+	return 0;
+}
+
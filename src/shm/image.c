@@ -0,0 +1,169 @@
+#include "image.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 将同名的已有映像标记为失效,仍映射着它的读者据此重新打开.
+static void shm_image_invalidate(const char *name)
+{
+	int fd = shm_open(name, O_RDWR, 0);
+	if(fd<0)
+		return;
+	struct stat st;
+	if(!fstat(fd, &st) && st.st_size>=(off_t)sizeof(shm_image_layout_t))
+	{
+		void *addr = mmap(NULL, sizeof(shm_image_layout_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+		if(addr!=MAP_FAILED)
+		{
+			__atomic_store_n(&((shm_image_layout_t*)addr)->magic, 0, __ATOMIC_RELEASE);
+			munmap(addr, sizeof(shm_image_layout_t));
+		}
+	}
+	close(fd);
+}
+
+int shm_image_create(shm_image_t *image, const char *name)
+{
+	// 崩溃重启后可能残留同名映像且仍被读者映射,不能原地清零(读者记录的序号会与新序号重合),
+	// 故使其失效并删除,再以O_EXCL创建新的对象.
+	shm_image_invalidate(name);
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0644);
+	if(fd<0)
+		return -1;
+	if(ftruncate(fd, sizeof(shm_image_layout_t)))
+	{
+		int err = errno;
+		close(fd);
+		shm_unlink(name);
+		errno = err;
+		return -1;
+	}
+
+	void *addr = mmap(NULL, sizeof(shm_image_layout_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(addr==MAP_FAILED)
+	{
+		int err = errno;
+		shm_unlink(name);
+		errno = err;
+		return -1;
+	}
+
+	image->layout = (shm_image_layout_t*)addr;
+	image->owner = 1;
+	snprintf(image->name, sizeof(image->name), "%s", name);
+
+	// magic最后写入,读者以此判断映像已就绪.
+	shm_image_layout_t *layout = image->layout;
+	memset(layout, 0, sizeof(shm_image_layout_t));
+	layout->block_num = SHM_IMAGE_BLOCK_NUM;
+	layout->block_regs = SHM_IMAGE_BLOCK_REGS;
+	__atomic_store_n(&layout->magic, SHM_IMAGE_MAGIC, __ATOMIC_RELEASE);
+	return 0;
+}
+
+void shm_image_destroy(shm_image_t *image)
+{
+	if(!image->layout)
+		return;
+	if(image->owner)
+		__atomic_store_n(&image->layout->magic, 0, __ATOMIC_RELEASE);
+	munmap(image->layout, sizeof(shm_image_layout_t));
+	image->layout = NULL;
+	if(image->owner)
+		shm_unlink(image->name);
+}
+
+// 在seqlock保护下写入一块中的[offset, offset+cnt),值未变化时不提交.
+static int32_t shm_image_write_block(shm_image_layout_t *layout, shm_image_block_t *block, 
+	int32_t offset, const uint16_t *values, int32_t cnt)
+{
+	uint32_t changed[SHM_IMAGE_BITMAP_WORDS];
+	int32_t i, changed_cnt = 0;
+	memset(changed, 0, sizeof(changed));
+	for(i=0; i<cnt; ++i)
+	{
+		if(block->regs[offset+i]!=values[i])
+		{
+			changed[(offset+i)>>5] |= 1u<<((offset+i)&31);
+			++changed_cnt;
+		}
+	}
+	if(!changed_cnt)
+		return 0;
+
+	uint32_t seq = block->seq;
+	__atomic_store_n(&block->seq, seq+1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&block->regs[offset], values, sizeof(uint16_t)*cnt);
+	memcpy(block->changed, changed, sizeof(changed));
+	__atomic_store_n(&block->seq, seq+2, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&layout->generation, 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+int32_t shm_image_write(shm_image_t *image, int32_t reg, const uint16_t *values, int32_t cnt)
+{
+	if(reg<0 || cnt<0 || reg+cnt>SHM_IMAGE_REG_NUM)
+		FATAL_ERROR("shm image write [%d, %d) exceeds %d registers.\n", reg, reg+cnt, SHM_IMAGE_REG_NUM);
+
+	shm_image_layout_t *layout = image->layout;
+	int32_t committed = 0;
+	while(cnt>0)
+	{
+		int32_t offset = reg%SHM_IMAGE_BLOCK_REGS;
+		int32_t this_cnt = SHM_IMAGE_BLOCK_REGS-offset;
+		if(this_cnt>cnt)
+			this_cnt = cnt;
+		committed += shm_image_write_block(layout, &layout->blocks[reg/SHM_IMAGE_BLOCK_REGS], 
+			offset, values, this_cnt);
+		reg += this_cnt;
+		values += this_cnt;
+		cnt -= this_cnt;
+	}
+	return committed;
+}
+
+int shm_image_open(shm_image_t *image, const char *name)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if(fd<0)
+		return -1;
+
+	struct stat st;
+	if(fstat(fd, &st) || st.st_size<(off_t)sizeof(shm_image_layout_t))
+	{
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+
+	void *addr = mmap(NULL, sizeof(shm_image_layout_t), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(addr==MAP_FAILED)
+		return -1;
+
+	shm_image_layout_t *layout = (shm_image_layout_t*)addr;
+	if(__atomic_load_n(&layout->magic, __ATOMIC_ACQUIRE)!=SHM_IMAGE_MAGIC || 
+		layout->block_num!=SHM_IMAGE_BLOCK_NUM || layout->block_regs!=SHM_IMAGE_BLOCK_REGS)
+	{
+		munmap(addr, sizeof(shm_image_layout_t));
+		errno = EPROTO;
+		return -1;
+	}
+
+	image->layout = layout;
+	image->owner = 0;
+	snprintf(image->name, sizeof(image->name), "%s", name);
+	return 0;
+}
+
+void shm_image_close(shm_image_t *image)
+{
+	shm_image_destroy(image);
+}
+
@@ -0,0 +1,73 @@
+
+#ifndef _SHM_IMAGE_H_
+#define _SHM_IMAGE_H_
+
+#include <stdint.h>
+#include "../platform.h"
+
+/*
+ * 共享内存中的寄存器映像布局.
+ *
+ * 映像共SHM_IMAGE_BLOCK_NUM块,每块SHM_IMAGE_BLOCK_REGS个16位寄存器,
+ * 寄存器地址reg所在的块为reg/SHM_IMAGE_BLOCK_REGS.
+ */
+#define SHM_IMAGE_MAGIC 0x504c4349 // "PLCI"
+#define SHM_IMAGE_BLOCK_REGS 64
+#define SHM_IMAGE_BLOCK_NUM 256
+#define SHM_IMAGE_REG_NUM (SHM_IMAGE_BLOCK_REGS*SHM_IMAGE_BLOCK_NUM)
+#define SHM_IMAGE_BITMAP_WORDS (SHM_IMAGE_BLOCK_REGS/32)
+
+/*
+ * seq : seqlock序号,奇数表示正在写入,seq/2即该块的代数;
+ * changed : 最近一次提交中值发生变化的寄存器位图;
+ * regs : 寄存器.
+ */
+typedef struct shm_image_block_t{
+	uint32_t seq;
+	uint32_t changed[SHM_IMAGE_BITMAP_WORDS];
+	uint16_t regs[SHM_IMAGE_BLOCK_REGS];
+}__attribute__((aligned(64))) shm_image_block_t;
+
+/*
+ * generation : 任一块提交时递增,读者据此快速判断映像是否有变化.
+ */
+typedef struct shm_image_layout_t{
+	uint32_t magic;
+	uint32_t block_num;
+	uint32_t block_regs;
+	uint32_t generation;
+	shm_image_block_t blocks[SHM_IMAGE_BLOCK_NUM];
+}shm_image_layout_t;
+
+#define shm_image_block_generation(seq) ((seq)>>1)
+
+/*
+ * shm_image : 映像的一次映射.
+ */
+typedef struct shm_image_t{
+	shm_image_layout_t *layout;
+	int32_t owner; // 是否为创建者(写者)
+	char name[32];
+}shm_image_t;
+
+/*
+ * 写者(PLC)一侧.
+ * 同名的已有映像(如崩溃前创建的)被标记为失效并删除,新映像为独立的共享内存对象;
+ * 写者销毁映像时同样将其标记为失效.
+ * 成功返回0,失败返回-1(errno保留).
+ */
+int shm_image_create(shm_image_t *image, const char *name);
+void shm_image_destroy(shm_image_t *image);
+
+/*
+ * 将values写入[reg, reg+cnt),按块提交,仅值发生变化的块递增代数.
+ * 返回提交的块数.
+ */
+int32_t shm_image_write(shm_image_t *image, int32_t reg, const uint16_t *values, int32_t cnt);
+
+// 读者一侧的映射.
+int shm_image_open(shm_image_t *image, const char *name);
+void shm_image_close(shm_image_t *image);
+
+#endif
+
@@ -0,0 +1,99 @@
+#include "reader.h"
+
+int shm_reader_open(shm_reader_t *reader, const char *name)
+{
+	memset(reader, 0, sizeof(shm_reader_t));
+	return shm_image_open(&reader->image, name);
+}
+
+void shm_reader_close(shm_reader_t *reader)
+{
+	shm_image_close(&reader->image);
+}
+
+int shm_reader_stale(shm_reader_t *reader)
+{
+	return __atomic_load_n(&reader->image.layout->magic, __ATOMIC_ACQUIRE)!=SHM_IMAGE_MAGIC;
+}
+
+int shm_reader_changed(shm_reader_t *reader)
+{
+	uint32_t generation = __atomic_load_n(&reader->image.layout->generation, __ATOMIC_ACQUIRE);
+	if(generation==reader->generation)
+		return 0;
+	reader->generation = generation;
+	return 1;
+}
+
+int32_t shm_reader_next_changed(shm_reader_t *reader, int32_t from)
+{
+	shm_image_layout_t *layout = reader->image.layout;
+	int32_t i;
+	for(i=(from<0)?0:from; i<SHM_IMAGE_BLOCK_NUM; ++i)
+	{
+		uint32_t seq = __atomic_load_n(&layout->blocks[i].seq, __ATOMIC_RELAXED);
+		if((seq&~1u)!=reader->seen[i])
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * seqlock读:序号为奇数(写入中)或读取前后序号不一致时重试.
+ * regs/changed为NULL时不拷贝.
+ */
+static uint32_t shm_reader_snapshot(shm_image_block_t *block, 
+	int32_t offset, int32_t cnt, uint16_t *regs, uint32_t *changed)
+{
+	uint32_t seq_begin, seq_end;
+	do{
+		seq_begin = __atomic_load_n(&block->seq, __ATOMIC_ACQUIRE);
+		if(seq_begin&1)
+			continue;
+		if(regs)
+			memcpy(regs, &block->regs[offset], sizeof(uint16_t)*cnt);
+		if(changed)
+			memcpy(changed, block->changed, sizeof(block->changed));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq_end = __atomic_load_n(&block->seq, __ATOMIC_RELAXED);
+	}while((seq_begin&1) || seq_begin!=seq_end);
+	return seq_begin;
+}
+
+uint32_t shm_reader_read_block(shm_reader_t *reader, int32_t block, 
+	uint16_t *regs, uint32_t *changed)
+{
+	if(block<0 || block>=SHM_IMAGE_BLOCK_NUM)
+		FATAL_ERROR("shm image block %d exceeds %d blocks.\n", block, SHM_IMAGE_BLOCK_NUM);
+
+	uint32_t seq = shm_reader_snapshot(&reader->image.layout->blocks[block], 
+		0, SHM_IMAGE_BLOCK_REGS, regs, changed);
+	if(changed && shm_image_block_generation(seq)!=shm_image_block_generation(reader->seen[block])+1)
+	{
+		int32_t i;
+		for(i=0; i<SHM_IMAGE_BITMAP_WORDS; ++i)
+			changed[i] = (seq==reader->seen[block])?0:0xffffffffu;
+	}
+	reader->seen[block] = seq;
+	return shm_image_block_generation(seq);
+}
+
+void shm_reader_read(shm_reader_t *reader, int32_t reg, uint16_t *values, int32_t cnt)
+{
+	if(reg<0 || cnt<0 || reg+cnt>SHM_IMAGE_REG_NUM)
+		FATAL_ERROR("shm image read [%d, %d) exceeds %d registers.\n", reg, reg+cnt, SHM_IMAGE_REG_NUM);
+
+	shm_image_layout_t *layout = reader->image.layout;
+	while(cnt>0)
+	{
+		int32_t offset = reg%SHM_IMAGE_BLOCK_REGS;
+		int32_t this_cnt = SHM_IMAGE_BLOCK_REGS-offset;
+		if(this_cnt>cnt)
+			this_cnt = cnt;
+		shm_reader_snapshot(&layout->blocks[reg/SHM_IMAGE_BLOCK_REGS], offset, this_cnt, values, NULL);
+		reg += this_cnt;
+		values += this_cnt;
+		cnt -= this_cnt;
+	}
+}
+
@@ -0,0 +1,49 @@
+
+#ifndef _SHM_READER_H_
+#define _SHM_READER_H_
+
+#include "image.h"
+
+/*
+ * shm_reader : 映像的读者,记录每块上次读取时的序号以判断变化.
+ *
+ * generation : 上次扫描时映像的代数;
+ * seen : 各块上次读取时的seqlock序号.
+ */
+typedef struct shm_reader_t{
+	shm_image_t image;
+	uint32_t generation;
+	uint32_t seen[SHM_IMAGE_BLOCK_NUM];
+}shm_reader_t;
+
+// 成功返回0,失败返回-1(errno保留).
+int shm_reader_open(shm_reader_t *reader, const char *name);
+void shm_reader_close(shm_reader_t *reader);
+
+// 映像是否已失效(写者已销毁或重新创建了映像),失效后读到的数据不再更新,应关闭后重新打开.
+int shm_reader_stale(shm_reader_t *reader);
+
+// 映像自上次shm_reader_changed以来是否有块提交.
+int shm_reader_changed(shm_reader_t *reader);
+
+/*
+ * 自块from起查找下一个自上次读取后发生变化的块,没有时返回-1.
+ */
+int32_t shm_reader_next_changed(shm_reader_t *reader, int32_t from);
+
+/*
+ * 读取一块的一致快照到regs(SHM_IMAGE_BLOCK_REGS个),并记录为已读.
+ * changed非NULL时填入自上次读取后变化的寄存器位图:
+ * 恰好相差一次提交时为该次提交的位图,相差更多时全部置位.
+ * 返回快照的代数.
+ */
+uint32_t shm_reader_read_block(shm_reader_t *reader, int32_t block, 
+	uint16_t *regs, uint32_t *changed);
+
+/*
+ * 读取[reg, reg+cnt)的快照,各块分别一致.
+ */
+void shm_reader_read(shm_reader_t *reader, int32_t reg, uint16_t *values, int32_t cnt);
+
+#endif
+